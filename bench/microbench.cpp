@@ -0,0 +1,331 @@
+// microbench.cpp
+// Microbenchmarks for the geometric kernels on fixed-seed synthetic input.
+//
+//   SurfaceBenchmark [--filter substr] [--samples N] [--warmup N] [--min-sample-ms f]
+//                    [--json out.json] [--baseline base.json] [--threshold f]
+//
+// Exits with 1 when a benchmark's median is more than --threshold (default 0.10)
+// slower than the same benchmark in --baseline.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "contour.h"
+#include "generator.h"
+#include "partition.h"
+#include "projection.h"
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BenchmarkOptions {
+    std::string filter;
+    size_t samples = 20;
+    size_t warmupSamples = 3;
+    double minSampleMs = 10.0;  // Iterations per sample are calibrated to reach this
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold = 0.10;
+};
+
+struct BenchmarkStats {
+    std::string name;
+    size_t iterations = 0;  // Per sample
+    size_t samples = 0;
+    double medianNs = 0.0;
+    double meanNs = 0.0;
+    double stddevNs = 0.0;
+    double minNs = 0.0;
+    double maxNs = 0.0;
+};
+
+// Keeps the compiler from discarding a result that is otherwise unused
+template <typename T>
+void doNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+double timeIterations(const std::function<void()>& body, size_t iterations) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        body();
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+BenchmarkStats runBenchmark(const std::string& name, const std::function<void()>& body,
+                            const BenchmarkOptions& options) {
+    BenchmarkStats stats;
+    stats.name = name;
+
+    double singleNs = std::max(1.0, timeIterations(body, 1));
+    stats.iterations = std::max<size_t>(1, static_cast<size_t>(options.minSampleMs * 1e6 / singleNs));
+
+    for (size_t i = 0; i < options.warmupSamples; i++) {
+        timeIterations(body, stats.iterations);
+    }
+
+    std::vector<double> perOp;
+    for (size_t i = 0; i < options.samples; i++) {
+        perOp.push_back(timeIterations(body, stats.iterations) / stats.iterations);
+    }
+
+    std::sort(perOp.begin(), perOp.end());
+    stats.samples = perOp.size();
+    stats.minNs = perOp.front();
+    stats.maxNs = perOp.back();
+    stats.medianNs = perOp.size() % 2 ? perOp[perOp.size() / 2]
+                                      : (perOp[perOp.size() / 2 - 1] + perOp[perOp.size() / 2]) / 2;
+    for (double t : perOp) stats.meanNs += t / perOp.size();
+    for (double t : perOp) stats.stddevNs += (t - stats.meanNs) * (t - stats.meanNs) / perOp.size();
+    stats.stddevNs = std::sqrt(stats.stddevNs);
+    return stats;
+}
+
+void writeJson(const std::string& path, const std::vector<BenchmarkStats>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    out << std::setprecision(10) << "{\"benchmarks\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& r = results[i];
+        out << (i ? ",\n  " : "\n  ")
+            << "{\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+            << ", \"samples\": " << r.samples << ", \"median_ns\": " << r.medianNs
+            << ", \"mean_ns\": " << r.meanNs << ", \"stddev_ns\": " << r.stddevNs
+            << ", \"min_ns\": " << r.minNs << ", \"max_ns\": " << r.maxNs << "}";
+    }
+    out << "\n]}\n";
+}
+
+// Reads name -> median_ns from a file written by writeJson
+std::map<std::string, double> readBaseline(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Could not open baseline " + path);
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    std::map<std::string, double> medians;
+    size_t pos = 0;
+    while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+        size_t open = text.find('"', text.find(':', pos) + 1);
+        size_t close = text.find('"', open + 1);
+        std::string name = text.substr(open + 1, close - open - 1);
+        size_t key = text.find("\"median_ns\"", close);
+        if (key == std::string::npos) break;
+        medians[name] = std::strtod(text.c_str() + text.find(':', key) + 1, nullptr);
+        pos = key;
+    }
+    return medians;
+}
+
+bool parseOptions(int argc, char** argv, BenchmarkOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) options.filter = argv[++i];
+        else if (arg == "--samples" && i + 1 < argc) options.samples = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--warmup" && i + 1 < argc) options.warmupSamples = std::stoul(argv[++i]);
+        else if (arg == "--min-sample-ms" && i + 1 < argc) options.minSampleMs = std::stod(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc) options.jsonPath = argv[++i];
+        else if (arg == "--baseline" && i + 1 < argc) options.baselinePath = argv[++i];
+        else if (arg == "--threshold" && i + 1 < argc) options.threshold = std::stod(argv[++i]);
+        else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// Befriended by SpacePartitioner and Projection to reach the private kernels
+class KernelBenchmarks {
+public:
+    explicit KernelBenchmarks(const BenchmarkOptions& options) : m_options(options) {
+        m_workDir = fs::temp_directory_path() / "surface_reconstruction_bench";
+        fs::remove_all(m_workDir);
+        fs::create_directories(m_workDir);
+
+        // Fixed seed so every run and every machine sees the same geometry
+        GeneratorOptions generator;
+        generator.shape = "torus";
+        generator.planes = 4;
+        generator.obliqueFraction = 0.25;
+        generator.verticesPerContour = 48;
+        generator.seed = 42;
+        m_contourPath = (m_workDir / "bench_torus.contour").string();
+        generateContourFile(generator, m_contourPath);
+
+        m_contourPlanes = parseContourFile(m_contourPath);
+        m_partitioner = std::make_unique<SpacePartitioner>(m_contourPlanes);
+        m_partitioner->setCacheDirectory((m_workDir / "convex_cells").string());
+        m_partitioner->partition();
+        if (m_partitioner->getConvexCells().size() < 2) {
+            throw std::runtime_error("Benchmark input produced fewer than two cells");
+        }
+        m_projection = std::make_unique<Projection>(*m_partitioner);
+    }
+
+    ~KernelBenchmarks() {
+        std::error_code ignored;
+        fs::remove_all(m_workDir, ignored);
+    }
+
+    std::vector<BenchmarkStats> run() {
+        const auto& cells = m_partitioner->getConvexCells();
+
+        add("parseContourFile", [&]() {
+            doNotOptimize(parseContourFile(m_contourPath));
+        });
+
+        std::string contourName = fs::path(m_contourPath).stem().string();
+        SpacePartitioner loader(m_contourPlanes);
+        loader.setCacheDirectory((m_workDir / "convex_cells").string());
+        add("loadConvexCells", [&]() {
+            doNotOptimize(loader.loadConvexCells(contourName));
+        });
+
+        Nef_polyhedron box = m_partitioner->computeBoundingBox();
+        const ExactKernel::Plane_3& plane = m_partitioner->m_exactPlanes[0];
+        add("partitionSpace/splitByPlane", [&]() {
+            Nef_polyhedron space = box;
+            doNotOptimize(SpacePartitioner::splitByPlane(space, plane));
+        });
+
+        CGAL::Polyhedron_3<ExactKernel> firstPoly = cells[0].geometry;
+        CGAL::Polyhedron_3<ExactKernel> secondPoly = cells[1].geometry;
+        Nef_polyhedron first(firstPoly);
+        Nef_polyhedron second(secondPoly);
+        size_t firstVertices = cells[0].geometry.size_of_vertices();
+        add("partition/coversCell", [&]() {
+            doNotOptimize(SpacePartitioner::coversCell(first, firstVertices, second));
+        });
+
+        add("computeAxisAlignedPlanes", [&]() {
+            doNotOptimize(m_projection->computeAxisAlignedPlanes(cells[0].mesh.bbox));
+        });
+
+        const AxisPlanes::Plane& axisPlane = m_projection->getAxisPlanesForCell(0).planes[0];
+        std::vector<Point> vertices(m_contourPlanes[0].vertices().begin(), m_contourPlanes[0].vertices().end());
+        add("projectVerticesOntoPlane", [&]() {
+            doNotOptimize(m_projection->projectVerticesOntoPlane(vertices, axisPlane));
+        });
+
+        auto clipCell = std::find_if(cells.begin(), cells.end(), [&](const SpacePartitioner::ConvexCell& cell) {
+            return !cell.planeIndices.empty() && cell.planeIndices.front() < m_projection->m_contourPlanes.size();
+        });
+        if (clipCell != cells.end()) {
+            std::vector<Projection::Halfspace> halfspaces = Projection::computeCellHalfspaces(clipCell->mesh);
+            std::vector<Point> clipped;
+            add("projectCell/clipContourToCell", [&]() {
+                m_projection->clipContourToCell(clipCell->planeIndices.front(), clipCell->mesh, halfspaces, clipped);
+                doNotOptimize(clipped);
+            });
+        }
+
+        std::vector<Point> combined = vertices;
+        std::vector<Point> projected = m_projection->projectVerticesOntoPlane(vertices, axisPlane);
+        combined.insert(combined.end(), projected.begin(), projected.end());
+        Projection::Triangulation T(combined.begin(), combined.end());
+        std::pmr::map<Point, size_t> vertexIndices;
+        for (size_t i = 0; i < combined.size(); i++) {
+            vertexIndices[combined[i]] = i;
+        }
+        std::vector<std::array<size_t, 3>> triangles;
+        add("reconstructCellSurface/extractTriangles", [&]() {
+            Projection::extractTriangles(T, vertexIndices, triangles);
+            doNotOptimize(triangles);
+        });
+        add("reconstructCellSurface/extractMaterialBoundary", [&]() {
+            Projection::CellSet inside;
+            Projection::classifyInsideCells(T, m_contourPlanes[0], axisPlane.axis, inside);
+            Projection::extractTriangles(T, vertexIndices, triangles, FacetExtraction::Material, &inside);
+            doNotOptimize(triangles);
+        });
+
+        return m_results;
+    }
+
+private:
+    BenchmarkOptions m_options;
+    fs::path m_workDir;
+    std::string m_contourPath;
+    std::vector<ContourPlane> m_contourPlanes;
+    std::unique_ptr<SpacePartitioner> m_partitioner;
+    std::unique_ptr<Projection> m_projection;
+    std::vector<BenchmarkStats> m_results;
+
+    void add(const std::string& name, const std::function<void()>& body) {
+        if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) return;
+        BenchmarkStats stats = runBenchmark(name, body, m_options);
+        std::cout << std::left << std::setw(42) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(14) << stats.medianNs << " ns"
+                  << "  +/- " << std::setw(5) << (stats.medianNs > 0 ? 100.0 * stats.stddevNs / stats.medianNs : 0.0)
+                  << "%  (" << stats.samples << " x " << stats.iterations << ")" << std::endl;
+        m_results.push_back(stats);
+    }
+};
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    try {
+        std::vector<BenchmarkStats> results = KernelBenchmarks(options).run();
+
+        if (!options.jsonPath.empty()) {
+            writeJson(options.jsonPath, results);
+            std::cout << "Wrote " << options.jsonPath << std::endl;
+        }
+
+        if (options.baselinePath.empty()) {
+            return 0;
+        }
+
+        std::map<std::string, double> baseline = readBaseline(options.baselinePath);
+        size_t regressions = 0;
+        std::cout << "\nAgainst " << options.baselinePath << " (threshold "
+                  << options.threshold * 100.0 << "%):" << std::endl;
+        for (const auto& r : results) {
+            auto it = baseline.find(r.name);
+            std::cout << std::left << std::setw(42) << r.name << std::right;
+            if (it == baseline.end() || it->second <= 0.0) {
+                std::cout << "  no baseline" << std::endl;
+                continue;
+            }
+            double change = r.medianNs / it->second - 1.0;
+            bool regressed = change > options.threshold;
+            regressions += regressed;
+            std::cout << std::showpos << std::setw(9) << change * 100.0 << "%" << std::noshowpos
+                      << (regressed ? "  REGRESSION" : "") << std::endl;
+        }
+        return regressions == 0 ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Benchmark error: " << e.what() << std::endl;
+        return 2;
+    }
+}
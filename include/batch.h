@@ -0,0 +1,56 @@
+// batch.h
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+#include "memory_stats.h"
+
+class PipelineContext;
+
+struct BatchOptions {
+    std::vector<std::string> inputFiles;
+    std::string outputDir;
+    size_t jobs = 1;
+    double planeMergeTolerance = 0.0;
+    double simplifyTolerance = 0.0;
+    size_t octreeDepth = 0;         // 0 partitions without blocks
+    size_t octreeBlockPlanes = 8;
+    size_t partitionThreads = 0;    // Per job, for octree blocks; 0 splits the hardware threads between jobs
+    std::string facets = "material";  // See parseFacetExtraction
+    double spillLimitMb = 0.0;      // Live heap above which partitioning spills to disk, 0 = never
+    double timeLimitSeconds = 0.0;  // Per file, 0 = unlimited
+    double memoryLimitMb = 0.0;     // Process-wide live heap, 0 = unlimited
+};
+
+struct BatchFileResult {
+    std::string file;
+    bool success = false;
+    std::string error;
+    size_t planeCount = 0;
+    size_t savedSplits = 0;  // Planes sharing a split with a coplanar neighbour
+    size_t contourVertices = 0;     // As parsed
+    size_t simplifiedVertices = 0;  // After --simplify; equal to contourVertices without it
+    size_t cellCount = 0;
+    size_t uniformCells = 0;  // Skipped: no material transition inside
+    size_t spilledPieces = 0;  // Partition pieces written to disk under --spill-limit
+    size_t meshCount = 0;
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    bool cellsFromCache = false;
+    double parseMs = 0.0;
+    double partitionMs = 0.0;
+    double reconstructionMs = 0.0;
+    double exportMs = 0.0;
+    MemoryReport memory;  // Shared with files processed concurrently when jobs > 1
+};
+
+// Parses "--batch <input dir|file list|.contour> <output dir> [--jobs N]
+//         [--merge-tolerance f] [--simplify f] [--octree depth] [--block-planes N] [--partition-threads N]
+//         [--facets all|hull|material] [--spill-limit mb] [--time-limit s] [--memory-limit mb]"
+bool parseBatchArguments(int argc, char** argv, BatchOptions& options);
+BatchFileResult processContourFile(PipelineContext& pipeline, const std::string& filePath,
+                                   const std::string& outputDir);
+int runBatch(const BatchOptions& options);
+
+#endif
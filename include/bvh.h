@@ -0,0 +1,50 @@
+// bvh.h
+#ifndef BVH_H
+#define BVH_H
+
+#include <CGAL/Bbox_3.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// View frustum as six inward-facing planes (a, b, c, d)
+class Frustum {
+public:
+    enum class Containment { Outside, Intersecting, Inside };
+
+    // Extracts the planes from a column-major view-projection matrix
+    static Frustum fromMatrix(const float* viewProjection);
+    Containment classify(const CGAL::Bbox_3& box) const;
+
+private:
+    std::array<std::array<double, 4>, 6> m_planes;
+};
+
+// Bounding volume hierarchy over a fixed set of boxes, built once per file load
+class BoundingVolumeHierarchy {
+public:
+    void build(const std::vector<CGAL::Bbox_3>& boxes);
+    // Appends the indices of all boxes that are at least partly inside the frustum
+    void query(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+    size_t size() const { return m_items.size(); }
+
+private:
+    static constexpr uint32_t LEAF_SIZE = 4;
+
+    struct Node {
+        CGAL::Bbox_3 box;
+        uint32_t left = 0;    // Child nodes, valid when count == 0
+        uint32_t right = 0;
+        uint32_t first = 0;   // Item range, valid for leaves
+        uint32_t count = 0;
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_items;
+    std::vector<CGAL::Bbox_3> m_boxes;
+
+    uint32_t buildNode(const std::vector<CGAL::Bbox_3>& boxes, uint32_t first, uint32_t count);
+    void collect(uint32_t nodeIndex, std::vector<uint32_t>& visible) const;
+};
+
+#endif
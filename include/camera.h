@@ -4,6 +4,7 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
 
 extern float cameraYaw;
 extern float cameraPitch;
@@ -11,12 +12,14 @@ extern float cameraRadius;  // Added for zoom
 extern float lastX, lastY;
 extern bool firstMouse;
 extern bool leftMouseButtonPressed;
+extern bool cameraChanged;  // Set whenever the view moves; cleared by the render loop
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);  // New
-void process_keyboard(GLFWwindow* window);  // New
+bool process_keyboard(GLFWwindow* window);  // True while a zoom key is held
 void updateCamera();
 void setupProjection(int width, int height);
+glm::mat4 getViewProjectionMatrix();  // Matrices last set by setupProjection/updateCamera
 
 #endif
\ No newline at end of file
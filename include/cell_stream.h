@@ -0,0 +1,40 @@
+// cell_stream.h
+#ifndef CELL_STREAM_H
+#define CELL_STREAM_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "contour.h"
+#include "partition.h"
+#include "projection.h"
+
+// Self-contained copy of one finished cell, so the consumer never touches
+// pipeline state that is still being built; surfaces are immutable and shared
+struct StreamedCell {
+    size_t cellIndex = 0;
+    SpacePartitioner::CellMesh mesh;
+    std::vector<std::shared_ptr<const ReconstructedMesh>> surfaces;
+};
+
+// Everything published since the previous drain()
+struct CellStreamBatch {
+    bool started = false;                     // A new load began; contourPlanes holds its input
+    std::vector<ContourPlane> contourPlanes;
+    std::vector<StreamedCell> cells;          // In completion order, not cell order
+};
+
+// Thread-safe hand-off of finished cells from pipeline workers to the render loop
+class CellStream {
+public:
+    // Starts a new load and drops anything left over from the previous one
+    void begin(const std::vector<ContourPlane>& contourPlanes);
+    void push(StreamedCell cell);
+    CellStreamBatch drain();
+
+private:
+    std::mutex m_mutex;
+    CellStreamBatch m_pending;
+};
+
+#endif
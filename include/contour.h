@@ -6,7 +6,12 @@
 #include <CGAL/Extended_cartesian.h>
 #include <CGAL/Polyhedron_3.h>
 #include <CGAL/Plane_3.h>
-#include <GL/glew.h>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
 
 typedef CGAL::Extended_cartesian<CGAL::Gmpq> ExactKernel;
 typedef CGAL::Exact_predicates_inexact_constructions_kernel InexactKernel;
@@ -29,24 +34,121 @@ struct ExtendedMesh {
     std::vector<std::pair<size_t, size_t>> contourEdges;
 };
 
-struct ContourPlane {
-    Plane plane;
-    std::vector<Point> vertices;
-    std::vector<std::pair<int, int>> edges;
+// Everything parsed from one contour file in a few contiguous arrays shared by
+// all of its planes: coordinates as structure-of-arrays, edges as 32-bit
+// plane-local vertex indices, extended meshes out of line
+struct ContourStore {
+    struct PlaneRecord {
+        Plane plane;
+        uint32_t firstVertex = 0;
+        uint32_t vertexCount = 0;
+        uint32_t firstEdge = 0;
+        uint32_t edgeCount = 0;
+        int32_t extMesh = -1;  // Index into extMeshes
+    };
     std::string filename;
-    bool hasExt = false;
-    ExtendedMesh extMesh;
+    std::vector<double> x, y, z;
+    std::vector<std::array<uint32_t, 2>> edges;
+    std::vector<std::array<int32_t, 2>> edgeMaterials;  // (m1, m2) for each edge
+    std::vector<ExtendedMesh> extMeshes;
+    std::vector<PlaneRecord> planes;
+};
+
+// Lightweight view of one plane of a ContourStore; copies share the store
+class ContourPlane {
+public:
+    typedef std::array<uint32_t, 2> Edge;
+    typedef std::array<int32_t, 2> Materials;
+
+    // Random-access range over the plane's vertices, yielding Points by value
+    class Vertices {
+    public:
+        class iterator {
+        public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef Point value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const Point* pointer;
+            typedef Point reference;
+
+            iterator(const ContourStore* store = nullptr, size_t index = 0) : m_store(store), m_index(index) {}
+            Point operator*() const { return Point(m_store->x[m_index], m_store->y[m_index], m_store->z[m_index]); }
+            Point operator[](difference_type n) const { return *(*this + n); }
+            iterator& operator++() { ++m_index; return *this; }
+            iterator operator++(int) { iterator old = *this; ++m_index; return old; }
+            iterator& operator--() { --m_index; return *this; }
+            iterator operator--(int) { iterator old = *this; --m_index; return old; }
+            iterator& operator+=(difference_type n) { m_index += n; return *this; }
+            iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+            iterator operator+(difference_type n) const { return iterator(m_store, m_index + n); }
+            iterator operator-(difference_type n) const { return iterator(m_store, m_index - n); }
+            difference_type operator-(const iterator& other) const {
+                return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+            }
+            bool operator==(const iterator& other) const { return m_index == other.m_index; }
+            bool operator!=(const iterator& other) const { return m_index != other.m_index; }
+            bool operator<(const iterator& other) const { return m_index < other.m_index; }
+
+        private:
+            const ContourStore* m_store;
+            size_t m_index;
+        };
+
+        Vertices(const ContourStore* store, size_t first, size_t count)
+            : m_begin(store, first), m_end(store, first + count) {}
+        iterator begin() const { return m_begin; }
+        iterator end() const { return m_end; }
+        size_t size() const { return m_end - m_begin; }
+        bool empty() const { return m_begin == m_end; }
+        Point operator[](size_t i) const { return m_begin[i]; }
+
+    private:
+        iterator m_begin, m_end;
+    };
+
+    ContourPlane() = default;
+    ContourPlane(std::shared_ptr<const ContourStore> store, uint32_t index)
+        : m_store(std::move(store)), m_index(index) {}
+
+    const Plane& plane() const { return record().plane; }
+    Vertices vertices() const { return Vertices(m_store.get(), record().firstVertex, record().vertexCount); }
+    size_t vertexCount() const { return record().vertexCount; }
+    Point vertex(size_t i) const { return vertices()[i]; }
+    size_t edgeCount() const { return record().edgeCount; }
+    const Edge& edge(size_t i) const { return m_store->edges[record().firstEdge + i]; }
+    const Materials& edgeMaterials(size_t i) const { return m_store->edgeMaterials[record().firstEdge + i]; }
+    const std::string& filename() const { return m_store->filename; }
+    bool hasExt() const { return record().extMesh >= 0; }
+    const ExtendedMesh& extMesh() const { return m_store->extMeshes[record().extMesh]; }
+    const ContourStore& store() const { return *m_store; }
+    uint32_t index() const { return m_index; }
 
     bool operator==(const ContourPlane& other) const {
-        return plane == other.plane &&
-               vertices == other.vertices &&
-               edges == other.edges &&
-               filename == other.filename;
+        return m_store == other.m_store && m_index == other.m_index;
     }
+
+private:
+    const ContourStore::PlaneRecord& record() const { return m_store->planes[m_index]; }
+
+    std::shared_ptr<const ContourStore> m_store;
+    uint32_t m_index = 0;
+};
+
+// Appends planes to a new ContourStore; build() hands out one view per plane
+class ContourStoreBuilder {
+public:
+    explicit ContourStoreBuilder(const std::string& filename);
+    void beginPlane(const Plane& plane);
+    // Vertices are numbered from 0 within their plane, in the order added
+    void addVertex(const Point& p);
+    void addEdge(uint32_t v1, uint32_t v2, int32_t m1, int32_t m2);
+    void setExtendedMesh(ExtendedMesh mesh);
+    std::vector<ContourPlane> build();
+
+private:
+    std::shared_ptr<ContourStore> m_store;
 };
 
 std::vector<ContourPlane> parseContourFile(const std::string& filePath);
-void renderContourPlanes(const std::vector<ContourPlane>& planes);
-void renderExtendedMesh(const ExtendedMesh& mesh);
 
 #endif
\ No newline at end of file
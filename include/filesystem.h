@@ -22,14 +22,17 @@ public:
     bool selectFile(size_t index);
     std::vector<ContourPlane> getCurrentContours() const { return m_currentContours; }
     std::string getCurrentFileName() const { return m_files[m_currentIndex]; }
+    std::string getFileName(size_t index) const { return m_files[index]; }
     size_t getCurrentIndex() const { return m_currentIndex; }
     size_t getFileCount() const { return m_files.size(); }
+    double getLastParseMs() const { return m_lastParseMs; }
 
 private:
     std::string m_dataPath;
     std::vector<std::string> m_files;
     size_t m_currentIndex;
     std::vector<ContourPlane> m_currentContours;
+    double m_lastParseMs = 0.0;
     void loadCurrentFile();
 };
 
@@ -0,0 +1,28 @@
+// generator.h
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <string>
+#include <vector>
+
+struct GeneratorOptions {
+    std::string shape = "torus";     // torus, branch or blob
+    std::string output;              // .contour file, or a directory with --series
+    size_t planes = 8;
+    double obliqueFraction = 0.0;    // Share of planes tilted away from the main axis
+    size_t verticesPerContour = 32;  // Each closed loop is resampled to this many vertices
+    bool extendedMesh = false;       // Add ~ blocks lofting parallel slices together
+    unsigned seed = 1;
+    std::vector<size_t> series;      // Plane counts; writes <shape>_<N>.contour for each
+    int insideMaterial = 17;
+    int outsideMaterial = 0;
+};
+
+// Parses "--generate <torus|branch|blob> <output> [--planes N] [--oblique f]
+//         [--vertices N] [--ext] [--seed S] [--series N1,N2,...]"
+bool parseGeneratorArguments(int argc, char** argv, GeneratorOptions& options);
+// Slices the implicit shape and writes the contour file; returns the planes written
+size_t generateContourFile(const GeneratorOptions& options, const std::string& path);
+int runGenerator(const GeneratorOptions& options);
+
+#endif
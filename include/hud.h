@@ -0,0 +1,71 @@
+// hud.h
+#ifndef HUD_H
+#define HUD_H
+
+#include <GL/glew.h>
+#include <array>
+#include <string>
+#include <vector>
+#include "memory_stats.h"
+#include "render.h"
+#include "timing.h"
+
+// Bitmap text drawn from a glyph atlas that is rasterized once.
+// Text queued with addText() is submitted in a single draw call by flush().
+class TextRenderer {
+public:
+    TextRenderer() = default;
+    ~TextRenderer();
+    TextRenderer(const TextRenderer&) = delete;
+    TextRenderer& operator=(const TextRenderer&) = delete;
+
+    void init();
+    void addText(const std::string& text, float x, float y,
+                 const std::array<float, 3>& color = {0.0f, 0.0f, 0.0f});
+    void flush(int width, int height);
+    size_t getLastDrawCalls() const { return m_lastDrawCalls; }
+
+private:
+    static constexpr int FIRST_GLYPH = 32;
+    static constexpr int GLYPH_COUNT = 95;
+    static constexpr int ATLAS_COLUMNS = 16;
+    static constexpr int CELL_WIDTH = 16;
+    static constexpr int CELL_HEIGHT = 20;
+    static constexpr int GLYPH_DESCENT = 5;
+    static constexpr int ATLAS_WIDTH = 256;
+    static constexpr int ATLAS_HEIGHT = 128;
+
+    GLuint m_texture = 0;
+    GLuint m_vbo = 0;
+    std::array<int, GLYPH_COUNT> m_advance{};
+    std::vector<float> m_vertices;  // x, y, u, v, r, g, b per quad corner
+    size_t m_lastDrawCalls = 0;
+
+    void buildAtlas();
+};
+
+// Frame time percentiles, draw statistics and the last load's stage timings and memory
+class PerformanceHud {
+public:
+    PerformanceHud();
+
+    void recordFrame(double frameMs);
+    void setLoadTimings(const PipelineTimings& timings) { m_timings = timings; }
+    void setLoadMemory(const MemoryReport& memory) { m_memory = memory; }
+    void setCellCount(size_t cellCount) { m_cellCount = cellCount; }
+    void draw(TextRenderer& text, const RenderStats& stats, float x, float y) const;
+
+private:
+    static constexpr size_t FRAME_HISTORY = 240;
+
+    std::vector<double> m_frameTimes;
+    size_t m_nextFrame = 0;
+    size_t m_recordedFrames = 0;
+    PipelineTimings m_timings;
+    MemoryReport m_memory;
+    size_t m_cellCount = 0;
+
+    std::array<double, 3> computePercentiles() const;
+};
+
+#endif
@@ -0,0 +1,55 @@
+// memory_stats.h
+#ifndef MEMORY_STATS_H
+#define MEMORY_STATS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Heap accounting by pipeline stage. Global operator new/delete and GMP's
+// allocation functions are routed through a counting allocator that tags each
+// block with the stage active on the allocating thread, so frees are credited
+// back to the stage that allocated the block.
+enum class MemoryStage : uint32_t {
+    Other,
+    Parse,
+    Partition,      // Bounding box and the partitionSpace work stack
+    Filter,         // Elementary cell filter
+    Projection,     // Axis planes and contour projection
+    Triangulation,  // Per-cell surface reconstruction
+    Count
+};
+
+constexpr size_t MEMORY_STAGE_COUNT = static_cast<size_t>(MemoryStage::Count);
+
+const char* memoryStageName(MemoryStage stage);
+
+struct MemoryReport {
+    std::array<int64_t, MEMORY_STAGE_COUNT> liveBytes{};
+    std::array<int64_t, MEMORY_STAGE_COUNT> peakBytes{};  // Since the last resetMemoryPeaks()
+    int64_t totalLiveBytes = 0;
+    int64_t totalPeakBytes = 0;
+
+    int64_t peak(MemoryStage stage) const { return peakBytes[static_cast<size_t>(stage)]; }
+};
+
+MemoryReport getMemoryReport();
+// Lowers every peak to its current live value. Counters are process-wide, so
+// concurrent pipeline runs (batch --jobs > 1) share them.
+void resetMemoryPeaks();
+
+// Sets the calling thread's stage for its lifetime and restores the previous one
+class MemoryStageScope {
+public:
+    explicit MemoryStageScope(MemoryStage stage);
+    ~MemoryStageScope();
+    MemoryStageScope(const MemoryStageScope&) = delete;
+    MemoryStageScope& operator=(const MemoryStageScope&) = delete;
+
+private:
+    MemoryStage m_previous;
+};
+
+inline double toMegabytes(int64_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+#endif
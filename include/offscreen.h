@@ -0,0 +1,26 @@
+// offscreen.h
+#ifndef OFFSCREEN_H
+#define OFFSCREEN_H
+
+#include <string>
+
+struct OffscreenOptions {
+    std::string inputFile;
+    int width = 1280;
+    int height = 720;
+    int frames = 360;           // One full camera orbit is swept over all frames
+    std::string dumpDir;        // Write frame_NNNN.png here when set
+    std::string goldenDir;      // Compare against frame_NNNN.png here when set
+    double tolerance = 0.001;   // Allowed fraction of differing pixels per frame
+    double simplifyTolerance = 0.0;  // Contour simplification distance, 0 = off
+    std::string facets = "material";  // See parseFacetExtraction
+};
+
+// Parses "--offscreen <file.contour> [--frames N] [--size WxH] [--dump dir]
+//         [--golden dir] [--tolerance f] [--simplify f]
+//         [--facets all|hull|material]"
+bool parseOffscreenArguments(int argc, char** argv, OffscreenOptions& options);
+// Renders an orbit into an EGL surfaceless framebuffer; no display is needed
+int runOffscreen(const OffscreenOptions& options);
+
+#endif
@@ -3,40 +3,174 @@
 #define PARTITION_H
 
 #include <CGAL/Nef_polyhedron_3.h>
+#include <CGAL/Bbox_3.h>
 #include "contour.h"
+#include "run_control.h"
+#include "thread_pool.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <set>
+#include <string>
 
 typedef CGAL::Nef_polyhedron_3<ExactKernel> Nef_polyhedron;
 
 class SpacePartitioner {
 public:
+    // Double-precision copy of a cell, built once so rendering and
+    // projection never have to convert exact coordinates again
+    struct CellMesh {
+        std::vector<std::array<double, 3>> vertices;
+        std::vector<std::pair<uint32_t, uint32_t>> edges;  // Each edge once
+        std::vector<uint32_t> faceIndices;  // Vertex loops of all faces
+        std::vector<uint32_t> faceOffsets;  // Face f spans [faceOffsets[f], faceOffsets[f+1])
+        CGAL::Bbox_3 bbox;
+    };
+
     struct ConvexCell {
         CGAL::Polyhedron_3<ExactKernel> geometry;
-        std::vector<size_t> planeIndices;  // Indices of defining planes
+        std::vector<size_t> planeIndices;  // Contour planes the cell lies on the positive side of
+        CellMesh mesh;
     };
 
     SpacePartitioner(const std::vector<ContourPlane>& contourPlanes);
     void partition();
     bool loadConvexCells(const std::string& contourName);
     void saveConvexCells(const std::string& contourName) const;
-    void renderPolyhedron(const ConvexCell& cell, bool highlight = false) const;
     const std::vector<ConvexCell>& getConvexCells() const { return m_cells; }
     std::vector<ContourPlane> getPlanesForCell(size_t cellIndex) const;
+    // The planes cells' planeIndices refer to
+    const std::vector<ContourPlane>& getContourPlanes() const { return m_contourPlanes; }
+    void setCacheDirectory(const std::string& path) { m_cacheDir = path; }
+    bool loadedFromCache() const { return m_loadedFromCache; }
+    double getPartitionMs() const { return m_partitionMs; }
+    double getFilterMs() const { return m_filterMs; }
+    // Planes whose normals differ by at most tolerance (cross product length) and whose
+    // offsets differ by at most tolerance share one split; 0 merges only exact coplanars
+    void setPlaneMergeTolerance(double tolerance) { m_planeMergeTolerance = tolerance; }
+    // Appended to the cache name when the contours differ from the file on disk
+    void setCacheTag(const std::string& tag) { m_cacheTag = tag; }
+    // partition() checks control between splits and filter steps and throws
+    // RunCancelled when it says stop; nothing is cached for a stopped run
+    void setRunControl(RunControl* control) { m_control = control; }
+    // Octree domain decomposition: the bounding box is split into up to maxDepth
+    // levels of blocks until each sees at most blockPlanes planes whose contours pass
+    // near it; blocks are partitioned on pool and their cells stitched together.
+    // A depth of 0 partitions the whole box with every plane
+    void setBlockDecomposition(size_t maxDepth, size_t blockPlanes) {
+        m_octreeDepth = maxDepth;
+        m_octreeBlockPlanes = blockPlanes;
+    }
+    void setThreadPool(ThreadPool* pool) { m_pool = pool; }
+    // Live heap (process-wide, see memory_stats.h) above which partition() moves
+    // pending and finished pieces to disk until they are needed; 0 never spills
+    void setSpillLimit(int64_t bytes) { m_spillLimit = bytes; }
+    size_t getSpilledPieces() const { return m_spilledPieces; }
+    size_t getSplitPlaneCount() const { return m_planeGroups.size(); }
+    size_t getSavedSplits() const { return m_contourPlanes.size() - m_planeGroups.size(); }
 
 private:
+    friend class KernelBenchmarks;
+
     std::string getConvexCellsPath(const std::string& contourName) const;
     void ensureDirectoryExists(const std::string& path) const;
-    std::vector<ExactKernel::Plane_3> m_exactPlanes;
+    static CellMesh buildCellMesh(const CGAL::Polyhedron_3<ExactKernel>& poly);
+    void buildCellMeshes();
+    std::vector<ExactKernel::Plane_3> m_exactPlanes;     // One per plane group
+    std::vector<std::vector<size_t>> m_planeGroups;      // Contour planes sharing each split
+    std::vector<bool> m_flippedInGroup;  // Per contour plane: faces opposite to its group's split
+    void groupCoplanarPlanes();
     void precomputePlanes();
-    void partitionSpace(Nef_polyhedron& space, 
-                       size_t planeIndex,
-                       std::vector<std::pair<Nef_polyhedron, std::set<size_t>>>& nefPolys);
+    // Upper bound on splitByPlane calls: cells of an arrangement of 0..n-1 planes
+    static size_t estimateSplitCount(size_t planeCount);
+    // Piece of space with the contour planes it lies on the positive side of.
+    // Move-only; over the spill limit its geometry waits in a file instead
+    struct NefCell {
+        std::unique_ptr<Nef_polyhedron> nef;  // Null while spilled
+        std::string spillPath;
+        std::set<size_t> planes;
+        CGAL::Bbox_3 bbox;       // Set once the piece is a candidate cell
+        size_t vertexCount = 0;  // Of the candidate's polyhedron, for coversCell
+    };
+    typedef std::vector<NefCell> NefCells;
+    struct PendingSplit {
+        NefCell piece;
+        size_t position;  // Next index into the plane list
+    };
+    // Splits space by every plane in order, depth first from an explicit work
+    // stack, appending the candidate cells
+    void partitionSpace(Nef_polyhedron space, const std::vector<size_t>& planes, NefCells& cells);
+    // Gives both halves of a piece split by group the parent's plane set, and adds
+    // each of the group's contour planes to the half on its own positive side.
+    // Stitching block cells compares these sets, so every cell must carry exactly its own
+    void assignSplitSides(size_t group, const std::set<size_t>& parentPlanes,
+                          NefCell& positive, NefCell& negative) const;
+    // Spills the oldest resident entries of both lists while the heap is over the
+    // limit; the next pending split stays in memory. The counts are the already
+    // spilled prefixes
+    void enforceSpillLimit(std::vector<PendingSplit>& pending, size_t& pendingSpilled,
+                           NefCells& cells, size_t& cellsSpilled);
+    void spill(NefCell& cell);
+    // Moves the geometry out, reading and deleting its spill file if needed
+    Nef_polyhedron restore(NefCell& cell) const;
+    // Shares resident geometry or reads a spilled copy
+    Nef_polyhedron peek(const NefCell& cell) const;
+    // Indices of the candidates not covered by any other candidate
+    std::vector<size_t> findElementaryCells(const NefCells& cells, bool reportProgress) const;
+
+    // Leaf of the block octree with the plane groups relevant to it
+    struct Block {
+        Point min;
+        Point max;
+        std::vector<size_t> planes;
+    };
+    void buildBlocks(const Point& min_corner, const Point& max_corner,
+                     const std::vector<size_t>& planes, size_t depth,
+                     const std::vector<CGAL::Bbox_3>& contourBoxes,
+                     std::vector<Block>& blocks) const;
+    // Elementary cell of one block; seen holds the contour planes its block split by
+    struct BlockCell {
+        CGAL::Polyhedron_3<ExactKernel> geometry;
+        std::set<size_t> planes;
+        std::set<size_t> seen;
+    };
+    // Writes finished cells into a private directory as they are produced and
+    // renames it into place on commit(); without commit nothing is left behind
+    class CacheWriter;
+    void partitionBlocks(CacheWriter& cache);
+    // Merges cells cut apart only by block faces back into one cell each
+    void stitchBlockCells(std::vector<BlockCell>& cells) const;
+    // True when a and b together form the convex hull, which is returned in hull
+    static bool isConvexUnion(const CGAL::Polyhedron_3<ExactKernel>& a,
+                              const CGAL::Polyhedron_3<ExactKernel>& b,
+                              CGAL::Polyhedron_3<ExactKernel>& hull);
+    // Returns the part of space on the positive side of plane and leaves the rest in space
+    static Nef_polyhedron splitByPlane(Nef_polyhedron& space, const ExactKernel::Plane_3& plane);
+    // True when other overlaps all of cell, so cell is not elementary
+    static bool coversCell(const Nef_polyhedron& cell, size_t cellVertexCount, const Nef_polyhedron& other);
     Nef_polyhedron computeBoundingBox() const;
+    static Nef_polyhedron makeBox(const Point& min_corner, const Point& max_corner);
     std::pair<Point, Point> getBBoxCorners() const;
     
     std::vector<ConvexCell> m_cells;
     std::vector<ContourPlane> m_contourPlanes;
-    Nef_polyhedron m_partitionedSpace;
+    std::string m_cacheDir = "../data/convex_cells";
+    bool m_loadedFromCache = false;
+    double m_partitionMs = 0.0;
+    double m_filterMs = 0.0;
+    double m_planeMergeTolerance = 0.0;
+    std::string m_cacheTag;
+    RunControl* m_control = nullptr;
+    std::atomic<size_t> m_splitsDone{0};  // Blocks split concurrently
+    size_t m_estimatedSplits = 0;
+    size_t m_octreeDepth = 0;
+    size_t m_octreeBlockPlanes = 8;
+    ThreadPool* m_pool = nullptr;
+    int64_t m_spillLimit = 0;
+    std::string m_spillDir;
+    std::atomic<size_t> m_spillFiles{0};  // Names spill files uniquely
+    std::atomic<size_t> m_spilledPieces{0};
 };
 
 #endif
\ No newline at end of file
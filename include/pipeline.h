@@ -0,0 +1,71 @@
+// pipeline.h
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "cell_stream.h"
+#include "contour.h"
+#include "memory_stats.h"
+#include "partition.h"
+#include "projection.h"
+#include "run_control.h"
+#include "simplify.h"
+#include "thread_pool.h"
+#include "timing.h"
+
+struct PipelineOptions {
+    std::string cacheDir = "../data/convex_cells";
+    size_t threads = 0;  // Worker threads for per-cell reconstruction, 0 = hardware threads
+    double planeMergeTolerance = 0.0;  // See SpacePartitioner::setPlaneMergeTolerance
+    double simplifyTolerance = 0.0;    // Contour simplification distance, 0 = off
+    size_t octreeDepth = 0;            // See SpacePartitioner::setBlockDecomposition, 0 = off
+    size_t octreeBlockPlanes = 8;
+    size_t partitionThreads = 0;       // Own pool for octree blocks; 0 shares the reconstruction pool
+    int64_t spillLimitBytes = 0;       // See SpacePartitioner::setSpillLimit, 0 = never spill
+    FacetExtraction facetExtraction = FacetExtraction::Material;  // Surface facets kept per cell
+    RunBudget budget;                  // Per run; exceeding it throws RunCancelled
+};
+
+// Optional per-run attachments; all may be left empty
+struct RunHooks {
+    CellStream* stream = nullptr;               // Receives contours, then each finished cell
+    const CancellationToken* cancel = nullptr;  // Checked between splits, filter steps and cells
+    ProgressCallback progress;                  // May be called from pool workers
+};
+
+// Everything derived from one contour file
+struct PipelineResult {
+    std::vector<ContourPlane> contourPlanes;
+    std::unique_ptr<SpacePartitioner> partitioner;
+    std::unique_ptr<Projection> projection;
+    PipelineTimings timings;
+    SimplificationStats simplification;  // Vertex counts are equal when simplification is off
+    MemoryReport memory;  // Peaks since the last resetMemoryPeaks(); run(filePath) resets before parsing
+};
+
+// Long-lived entry point to parse -> partition -> reconstruction. The thread pool
+// and per-thread scratch buffers are created once and reused by every run().
+// One run() at a time per context; use one context per concurrent caller.
+class PipelineContext {
+public:
+    explicit PipelineContext(const PipelineOptions& options = PipelineOptions());
+
+    // Hooks do not change the returned result. A cancelled or over-budget run
+    // throws RunCancelled and leaves nothing in the cell cache.
+    PipelineResult run(const std::string& filePath, const RunHooks& hooks = RunHooks());
+    PipelineResult run(std::vector<ContourPlane> contourPlanes, double parseMs = 0.0,
+                       const RunHooks& hooks = RunHooks());
+
+    const PipelineOptions& getOptions() const { return m_options; }
+    ThreadPool& getThreadPool() { return m_pool; }
+
+private:
+    PipelineOptions m_options;
+    ThreadPool m_pool;
+    std::unique_ptr<ThreadPool> m_partitionPool;  // Only with partitionThreads set
+    std::vector<ReconstructionScratch> m_scratch;  // One per pool slot
+};
+
+#endif
@@ -4,7 +4,15 @@
 
 #include "contour.h"
 #include "partition.h"
+#include "thread_pool.h"
+#include <memory>
+#include <map>
+#include <memory_resource>
+#include <set>
 #include <unordered_map>
+#include <CGAL/AABB_tree.h>
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_segment_primitive.h>
 #include <CGAL/Advancing_front_surface_reconstruction.h>
 #include <CGAL/Surface_mesh.h>
 #include <CGAL/Triangulation_3.h>
@@ -12,6 +20,8 @@
 #include <CGAL/Triangulation_vertex_base_3.h>
 #include <CGAL/Triangulation_cell_base_3.h>
 
+class CellStream;
+
 
 struct AxisPlanes {
     struct Plane {
@@ -22,6 +32,17 @@ struct AxisPlanes {
     std::vector<Plane> planes;
 };
 
+// Which facets of a cell's tetrahedralization become its surface
+enum class FacetExtraction {
+    All,       // Every finite facet, interior ones included
+    Hull,      // Facets on the convex hull of the points
+    Material   // Facets between tetrahedra inside and outside the contour's material,
+               // swept along the projection axis; Hull when that labels nothing inside
+};
+
+// Parses "all", "hull" or "material"
+FacetExtraction parseFacetExtraction(const std::string& name);
+
 struct ReconstructedMesh {
     CGAL::Surface_mesh<Point> mesh;
     std::vector<Point> vertices;
@@ -32,50 +53,120 @@ struct ProjectedContour {
     const ContourPlane* originalPlane;
     const AxisPlanes::Plane* projectionPlane;
     std::vector<Point> projectedVertices;
-    ReconstructedMesh reconstructedSurface;
+    // Immutable once built; cells using the same extended mesh share one instance
+    std::shared_ptr<const ReconstructedMesh> reconstructedSurface;
     bool useExtendedMesh = false;
 };
  
 struct CellProjections {
     size_t cellIndex;
     std::vector<ProjectedContour> projections;
+    int uniformMaterial = -1;  // Material filling a cell skipped for having no material transition
+};
+
+// Per-thread buffers reused across cells and across pipeline runs. Per-cell
+// temporaries are carved from the arena, which reset() rewinds between cells.
+struct ReconstructionScratch {
+    static constexpr size_t ARENA_BYTES = 256 * 1024;
+
+    ReconstructionScratch();
+    void reset() { arena->release(); }
+
+    std::vector<Point> combinedPoints;
+    std::vector<Point> clippedPoints;
+    std::unique_ptr<std::byte[]> arenaBuffer;
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena;  // Spills to the heap when full
 };
 
 class Projection {
 public:
-    Projection(const SpacePartitioner& partitioner);
+    // Cells are reconstructed on the pool when one is given; scratch needs one
+    // entry per pool slot and is allocated locally when omitted. Each finished
+    // cell is also copied to stream when one is given, and control is checked
+    // before each cell (throwing RunCancelled).
+    Projection(const SpacePartitioner& partitioner,
+               ThreadPool* pool = nullptr,
+               std::vector<ReconstructionScratch>* scratch = nullptr,
+               CellStream* stream = nullptr,
+               RunControl* control = nullptr,
+               FacetExtraction extraction = FacetExtraction::Material);
     
     size_t getCellCount() const { return m_cells.size(); }
     const std::vector<SpacePartitioner::ConvexCell>& getCells() const { return m_cells; }
     std::vector<ContourPlane> getPlanesForCell(size_t cellIndex) const;
     void debugPrintCellInfo() const;
-    void renderPlanesForAllCells() const;
     const AxisPlanes& getAxisPlanesForCell(size_t cellIndex) const;
-    void renderPlanesForCell(const CGAL::Polyhedron_3<ExactKernel>& poly) const;
-    void renderAllReconstructions() const;
+    const std::vector<CellProjections>& getCellProjections() const { return m_projectedContours; }
+    // Material filling the cell when none of its contours change material across
+    // an edge, so it has no surface and was not reconstructed; -1 otherwise
+    int getUniformMaterial(size_t cellIndex) const { return m_uniformMaterials[cellIndex]; }
+    size_t getUniformCellCount() const;
+    bool saveReconstructedSurfaces(const std::string& path) const;
 
 private:
+    friend class KernelBenchmarks;
+    typedef CGAL::Triangulation_3<InexactKernel> Triangulation;
+    typedef std::pmr::set<Triangulation::Cell_handle> CellSet;
+    typedef std::vector<InexactKernel::Segment_3> ContourSegments;
+    typedef CGAL::AABB_segment_primitive<InexactKernel, ContourSegments::const_iterator> SegmentPrimitive;
+    typedef CGAL::AABB_tree<CGAL::AABB_traits<InexactKernel, SegmentPrimitive>> SegmentTree;
+    // Inside when normal * p <= offset
+    struct Halfspace {
+        InexactKernel::Vector_3 normal;
+        double offset;
+    };
+
     std::vector<SpacePartitioner::ConvexCell> m_cells;
     std::vector<ContourPlane> m_contourPlanes;
+    std::vector<ContourSegments> m_contourSegments;            // Parallel to m_contourPlanes
+    std::vector<std::unique_ptr<SegmentTree>> m_segmentTrees;  // Built up front, queried from workers
+    std::vector<std::shared_ptr<const ReconstructedMesh>> m_extendedSurfaces;  // Per contour plane with ~ data
+    std::vector<int> m_planeMaterials;  // Per contour plane: its one material, or -1 when edges change material
+    std::vector<int> m_uniformMaterials;  // Per cell, see getUniformMaterial
     std::unordered_map<size_t, AxisPlanes> m_cellPlanes;
     std::vector<CellProjections> m_projectedContours;
+    FacetExtraction m_facetExtraction = FacetExtraction::Material;
 
     ReconstructedMesh reconstructCellSurface(
     const std::vector<Point>& originalVertices,
-    const std::vector<Point>& projectedVertices) const;
+    const std::vector<Point>& projectedVertices,
+    const ContourPlane& contour,
+    const AxisPlanes::Plane& projectionPlane,
+    ReconstructionScratch& scratch) const;
+    // Finite tetrahedra whose centroid, moved along the projection axis, lands inside
+    // the contour: odd crossings with edges separating two different materials.
+    // Returns false when the contour has no such edges
+    static bool classifyInsideCells(const Triangulation& T, const ContourPlane& contour,
+                                    char axis, CellSet& inside);
+    // One triangle per kept finite facet, indexed through vertexIndices; inside is
+    // only read for FacetExtraction::Material. Below dimension 3 every facet is kept
+    static void extractTriangles(const Triangulation& T,
+                                 std::pmr::map<Point, size_t>& vertexIndices,
+                                 std::vector<std::array<size_t, 3>>& triangles,
+                                 FacetExtraction mode = FacetExtraction::All,
+                                 const CellSet* inside = nullptr);
     ReconstructedMesh convertExtendedToReconstructedMesh(const ExtendedMesh& extMesh) const;
+    // Converts every extended mesh once, before cells are reconstructed
+    void convertExtendedMeshes();
     ReconstructedMesh triangulateVertices(const std::vector<Point>& vertices) const;
     void reconstructSurface(ProjectedContour& projection);
-    void renderReconstructedSurface(const ReconstructedMesh& mesh) const;
     double computePlaneDotProduct(const Plane& contourPlane, 
                                 const AxisPlanes::Plane& axisPlane) const;
     const AxisPlanes::Plane* selectProjectionPlane(const ContourPlane& contourPlane,
                                                  const AxisPlanes& axisPlanes) const;
     std::vector<Point> projectVerticesOntoPlane(const std::vector<Point>& vertices,
                                               const AxisPlanes::Plane& plane) const;
-    void computeProjections();
-    AxisPlanes computeAxisAlignedPlanes(const CGAL::Polyhedron_3<ExactKernel>& poly) const;
-    void renderAxisPlanes(const AxisPlanes& planes) const;
+    // Trees hold only the edges with different materials on either side
+    void buildSegmentTrees();
+    static std::vector<Halfspace> computeCellHalfspaces(const SpacePartitioner::CellMesh& mesh);
+    // Pieces of the plane's contour inside the cell, as deduplicated points
+    void clipContourToCell(size_t planeIdx, const SpacePartitioner::CellMesh& mesh,
+                           const std::vector<Halfspace>& halfspaces,
+                           std::vector<Point>& clipped) const;
+    void computeProjections(ThreadPool* pool, std::vector<ReconstructionScratch>* scratch,
+                            CellStream* stream, RunControl* control);
+    CellProjections projectCell(size_t cellIdx, ReconstructionScratch& scratch) const;
+    AxisPlanes computeAxisAlignedPlanes(const CGAL::Bbox_3& bbox) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,120 @@
+// render.h
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <GL/glew.h>
+#include <vector>
+#include "contour.h"
+#include "partition.h"
+#include "projection.h"
+#include "bvh.h"
+#include "cell_stream.h"
+
+// Debug views of the axis-aligned projection planes, drawn in immediate mode
+void renderAxisPlanes(const AxisPlanes& planes);
+void renderPlanesForAllCells(const Projection& projection);
+
+// Work submitted to the GPU since the last beginFrame()
+struct RenderStats {
+    size_t drawCalls = 0;
+    size_t triangles = 0;
+    size_t vertices = 0;
+};
+
+// Scene geometry uploaded to GPU buffers once per file load
+class SceneRenderer {
+public:
+    SceneRenderer() = default;
+    ~SceneRenderer();
+    SceneRenderer(const SceneRenderer&) = delete;
+    SceneRenderer& operator=(const SceneRenderer&) = delete;
+
+    void upload(const std::vector<ContourPlane>& contourPlanes,
+                const SpacePartitioner& partitioner,
+                const Projection& projection);
+    // Progressive loading: beginStream() shows the new contours right away and
+    // appendCells() adds finished cells as they arrive. The final upload()
+    // replaces the streamed geometry with the complete scene in cell order.
+    void beginStream(const std::vector<ContourPlane>& contourPlanes);
+    void appendCells(const std::vector<StreamedCell>& cells);
+    void renderContours() const;
+    void renderConvexCells(const Frustum& frustum) const;
+    void renderSurfaces(const Frustum& frustum) const;
+    void setCellHighlighted(size_t cellIndex, bool highlight);
+    size_t getCellCount() const { return m_cellRanges.size(); }
+    void beginFrame() { m_stats = RenderStats(); }
+    const RenderStats& getStats() const { return m_stats; }
+
+private:
+    struct DrawBatch {
+        GLuint vao = 0;
+        GLuint ibo = 0;
+        GLsizei indexCount = 0;
+    };
+
+    // Index range of one cell or one reconstruction inside a batch
+    struct Range {
+        GLuint first = 0;
+        GLsizei count = 0;
+    };
+
+    GLuint m_contourVbo = 0;
+    GLuint m_cellVbo = 0;
+    GLuint m_surfaceVbo = 0;
+    GLuint m_cellColorVbo = 0;  // Per-vertex colour, constant within each cell
+    DrawBatch m_contourLines;
+    DrawBatch m_cellLines;
+    DrawBatch m_surfaceTriangles;
+    DrawBatch m_surfaceEdges;
+    mutable RenderStats m_stats;
+
+    std::vector<Range> m_cellRanges;
+    std::vector<Range> m_cellVertexRanges;
+    std::vector<Range> m_surfaceTriangleRanges;
+    std::vector<Range> m_surfaceEdgeRanges;
+    std::vector<CGAL::Bbox_3> m_cellBoxes;
+    std::vector<CGAL::Bbox_3> m_surfaceBoxes;
+
+    // CPU copies of the cell and surface buffers; kept while streaming so
+    // buffers can grow, released after a full upload
+    std::vector<float> m_cellVertexData;
+    std::vector<float> m_cellColorData;
+    std::vector<GLuint> m_cellIndexData;
+    std::vector<float> m_surfaceVertexData;
+    std::vector<GLuint> m_surfaceIndexData;
+    std::vector<GLuint> m_surfaceEdgeIndexData;
+
+    // Bytes allocated for each streamed buffer; grown geometrically
+    struct StreamCapacity {
+        size_t cellVertices = 0;
+        size_t cellColors = 0;
+        size_t cellIndices = 0;
+        size_t surfaceVertices = 0;
+        size_t surfaceIndices = 0;
+        size_t surfaceEdges = 0;
+    };
+    StreamCapacity m_streamCapacity;
+    BoundingVolumeHierarchy m_cellBvh;
+    BoundingVolumeHierarchy m_surfaceBvh;
+    mutable std::vector<uint32_t> m_visible;  // Scratch for frustum queries
+    mutable std::vector<GLsizei> m_drawCounts;  // Scratch for multi-draw
+    mutable std::vector<const void*> m_drawOffsets;
+
+    void release();
+    void clearGeometry();
+    void uploadContours(const std::vector<ContourPlane>& contourPlanes);
+    void appendCellGeometry(const SpacePartitioner::CellMesh& mesh);
+    void appendSurfaceGeometry(const std::vector<Point>& vertices,
+                               const std::vector<std::array<size_t, 3>>& triangles);
+    // Uploads data[firstByte, totalBytes), reallocating the whole buffer when it is full
+    static void appendToBuffer(GLenum target, GLuint buffer, size_t& capacity,
+                               const void* data, size_t firstByte, size_t totalBytes);
+    static GLuint uploadVertices(const std::vector<float>& vertices);
+    static void uploadBatch(DrawBatch& batch, GLuint vbo, const std::vector<GLuint>& indices,
+                            GLuint colorVbo = 0);
+    void drawBatch(const DrawBatch& batch, GLenum mode) const;
+    void drawRanges(const DrawBatch& batch, GLenum mode, const std::vector<Range>& ranges,
+                    const std::vector<uint32_t>& visible) const;
+};
+
+#endif
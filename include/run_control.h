@@ -0,0 +1,61 @@
+// run_control.h
+#ifndef RUN_CONTROL_H
+#define RUN_CONTROL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+
+// Set by the caller, from any thread, to stop a run at its next check point
+class CancellationToken {
+public:
+    void cancel() { m_cancelled.store(true, std::memory_order_relaxed); }
+    void reset() { m_cancelled.store(false, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
+
+// Limits for one pipeline run; 0 disables a limit
+struct RunBudget {
+    double maxMs = 0.0;
+    int64_t maxHeapBytes = 0;  // Process-wide live heap as counted by memory_stats
+};
+
+struct RunProgress {
+    const char* stage;  // "partition", "filter" or "reconstruct"
+    size_t done;
+    size_t total;       // An upper-bound estimate for "partition"
+};
+
+typedef std::function<void(const RunProgress&)> ProgressCallback;
+
+// Thrown from a check point once a run is cancelled or over budget
+class RunCancelled : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Cooperative check points for one run. check() and report() may be called
+// from pool workers; progress callbacks are serialised.
+class RunControl {
+public:
+    RunControl(const CancellationToken* token = nullptr, const RunBudget& budget = RunBudget(),
+               ProgressCallback progress = nullptr);
+
+    void check() const;
+    void report(const char* stage, size_t done, size_t total);
+
+private:
+    const CancellationToken* m_token;
+    RunBudget m_budget;
+    ProgressCallback m_progress;
+    std::chrono::steady_clock::time_point m_start;
+    std::mutex m_progressMutex;
+};
+
+#endif
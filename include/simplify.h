@@ -0,0 +1,25 @@
+// simplify.h
+#ifndef SIMPLIFY_H
+#define SIMPLIFY_H
+
+#include <vector>
+#include "contour.h"
+
+struct SimplificationStats {
+    size_t inputVertices = 0;
+    size_t outputVertices = 0;
+    size_t skippedPlanes = 0;  // Extended-mesh planes and planes with dangling edges
+
+    double reduction() const {
+        return inputVertices ? 1.0 - static_cast<double>(outputVertices) / inputVertices : 0.0;
+    }
+};
+
+// Douglas-Peucker on every run of edges with the same direction and materials,
+// so each dropped vertex lies within tolerance of the segment that replaces it.
+// Junctions and material changes are kept, and a shortcut that would cross
+// another edge or pass to the other side of a vertex is split until it does not.
+// The planes are replaced by views into a new store holding the results.
+SimplificationStats simplifyContours(std::vector<ContourPlane>& contourPlanes, double tolerance);
+
+#endif
@@ -0,0 +1,46 @@
+// thread_pool.h
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads kept alive across pipeline runs
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = 0);  // 0 uses the hardware thread count
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return m_workers.size() + 1; }  // Workers plus the calling thread
+
+    // Runs task(index, slot) for every index in [0, count) and blocks until all finish.
+    // slot < size() identifies the executing thread, for indexing per-thread scratch.
+    // Calls from different threads are serialized; the first task exception is rethrown.
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& task);
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_callMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+
+    const std::function<void(size_t, size_t)>* m_task = nullptr;
+    size_t m_count = 0;
+    size_t m_next = 0;
+    size_t m_active = 0;
+    size_t m_generation = 0;
+    bool m_stopping = false;
+    std::exception_ptr m_error;
+
+    void workerLoop(size_t slot);
+    void runTasks(std::unique_lock<std::mutex>& lock, size_t slot);
+};
+
+#endif
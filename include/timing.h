@@ -0,0 +1,22 @@
+// timing.h
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <chrono>
+
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// Wall-clock cost of each stage of the last file load
+struct PipelineTimings {
+    double parseMs = 0.0;
+    double simplifyMs = 0.0;
+    double partitionMs = 0.0;   // Includes the elementary filter or cache load
+    double filterMs = 0.0;
+    double projectionMs = 0.0;
+    bool cellsFromCache = false;
+};
+
+#endif
@@ -0,0 +1,65 @@
+// trace.h
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Scoped trace markers written as Chrome trace-event JSON (open in Perfetto or
+// chrome://tracing). Each thread appends to its own buffer without locking;
+// while tracing is off a marker costs one relaxed atomic load.
+
+extern std::atomic<bool> g_traceEnabled;
+
+inline bool traceEnabled() { return g_traceEnabled.load(std::memory_order_relaxed); }
+
+int64_t traceNowNs();
+// name and argName must be string literals or otherwise outlive the session
+void recordTraceEvent(const char* name, int64_t startNs, int64_t endNs,
+                      const char* argName = nullptr, int64_t argValue = 0);
+// Labels the calling thread in the trace; the name must outlive the session
+void setTraceThreadName(const char* name);
+
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, const char* argName = nullptr, int64_t argValue = 0)
+        : m_name(traceEnabled() ? name : nullptr), m_argName(argName), m_argValue(argValue),
+          m_startNs(m_name ? traceNowNs() : 0) {}
+    ~TraceScope() {
+        if (m_name) recordTraceEvent(m_name, m_startNs, traceNowNs(), m_argName, m_argValue);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    const char* m_argName;
+    int64_t m_argValue;
+    int64_t m_startNs;
+};
+
+// Records for its lifetime and writes the JSON file on destruction.
+// An empty path leaves tracing disabled.
+class TraceSession {
+public:
+    explicit TraceSession(const std::string& path);
+    ~TraceSession();
+    TraceSession(const TraceSession&) = delete;
+    TraceSession& operator=(const TraceSession&) = delete;
+
+private:
+    std::string m_path;
+};
+
+// Removes "--trace <file>" from argv and returns the file, falling back to
+// the SURFACE_TRACE environment variable
+std::string parseTraceArguments(int& argc, char** argv);
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, argName, value) \
+    TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name, argName, static_cast<int64_t>(value))
+
+#endif
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Plot stage time and peak memory against plane count from a batch summary.csv.
+
+Usage: plot_scaling.py <summary.csv> [output.png]
+"""
+import csv
+import sys
+
+import matplotlib.pyplot as plt
+
+TIME_COLUMNS = ["parse_ms", "partition_ms", "reconstruction_ms", "export_ms"]
+MEMORY_COLUMNS = ["peak_mb", "partition_peak_mb", "filter_peak_mb",
+                  "projection_peak_mb", "triangulation_peak_mb"]
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.exit(__doc__)
+    output = sys.argv[2] if len(sys.argv) > 2 else "scaling.png"
+
+    with open(sys.argv[1], newline="") as f:
+        rows = [r for r in csv.DictReader(f) if r["status"] == "ok"]
+    cached = [r["file"] for r in rows if r["cells_from_cache"] == "1"]
+    if cached:
+        print("warning: partition loaded from cache for", ", ".join(cached))
+    rows.sort(key=lambda r: int(r["planes"]))
+    planes = [int(r["planes"]) for r in rows]
+
+    fig, (time_axis, memory_axis) = plt.subplots(1, 2, figsize=(12, 5))
+    for column in TIME_COLUMNS:
+        time_axis.plot(planes, [float(r[column]) for r in rows], marker="o", label=column)
+    time_axis.set(xscale="log", yscale="log", xlabel="planes", ylabel="ms", title="Stage time")
+    time_axis.legend()
+
+    for column in MEMORY_COLUMNS:
+        if column in rows[0]:
+            memory_axis.plot(planes, [float(r[column]) for r in rows], marker="o", label=column)
+    memory_axis.set(xscale="log", xlabel="planes", ylabel="MB", title="Peak heap")
+    memory_axis.legend()
+
+    fig.tight_layout()
+    fig.savefig(output)
+    print("Wrote", output)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,282 @@
+// batch.cpp
+#include "batch.h"
+#include "pipeline.h"
+#include "timing.h"
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace {
+
+std::mutex g_logMutex;
+
+std::vector<std::string> collectInputFiles(const std::string& input) {
+    std::vector<std::string> files;
+
+    if (fs::is_directory(input)) {
+        for (const auto& entry : fs::directory_iterator(input)) {
+            if (entry.path().extension() == ".contour") {
+                files.push_back(entry.path().string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+    }
+    else if (fs::path(input).extension() == ".contour") {
+        files.push_back(input);
+    }
+    else {
+        // Plain text file list, one path per line
+        std::ifstream list(input);
+        if (!list) {
+            throw std::runtime_error("Could not open input: " + input);
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty() && line[0] != '#') {
+                files.push_back(line);
+            }
+        }
+    }
+
+    // Outputs and cache entries are named by stem, so two inputs sharing one would
+    // overwrite each other's mesh and load each other's cells
+    std::map<std::string, std::string> stems;
+    for (const auto& file : files) {
+        auto [it, inserted] = stems.emplace(fs::path(file).stem().string(), file);
+        if (!inserted) {
+            throw std::runtime_error("Inputs " + it->second + " and " + file + " share the name " +
+                                     it->first + "; outputs would collide");
+        }
+    }
+
+    return files;
+}
+
+// RFC 4180 field: quoted, with embedded quotes doubled
+std::string csvField(const std::string& value) {
+    std::string field = "\"";
+    for (char c : value) {
+        if (c == '"') field += '"';
+        field += c;
+    }
+    return field + "\"";
+}
+
+void writeSummary(const std::string& path, const std::vector<BatchFileResult>& results) {
+    std::ofstream summary(path);
+    if (!summary) {
+        throw std::runtime_error("Could not write summary: " + path);
+    }
+
+    summary << "file,status,planes,saved_splits,contour_vertices,simplified_vertices,cells,uniform_cells,spilled_pieces,meshes,vertices,triangles,cells_from_cache,"
+            << "parse_ms,partition_ms,reconstruction_ms,export_ms,peak_mb";
+    for (size_t stage = 0; stage < MEMORY_STAGE_COUNT; stage++) {
+        summary << "," << memoryStageName(static_cast<MemoryStage>(stage)) << "_peak_mb";
+    }
+    summary << ",error" << std::endl;
+
+    for (const auto& r : results) {
+        summary << csvField(r.file) << ","
+                << (r.success ? "ok" : "failed") << ","
+                << r.planeCount << ","
+                << r.savedSplits << ","
+                << r.contourVertices << ","
+                << r.simplifiedVertices << ","
+                << r.cellCount << ","
+                << r.uniformCells << ","
+                << r.spilledPieces << ","
+                << r.meshCount << ","
+                << r.vertexCount << ","
+                << r.triangleCount << ","
+                << (r.cellsFromCache ? 1 : 0) << ","
+                << r.parseMs << ","
+                << r.partitionMs << ","
+                << r.reconstructionMs << ","
+                << r.exportMs << ","
+                << toMegabytes(r.memory.totalPeakBytes) << ",";
+        for (int64_t peak : r.memory.peakBytes) {
+            summary << toMegabytes(peak) << ",";
+        }
+        summary << csvField(r.error) << std::endl;
+    }
+}
+
+} // namespace
+
+bool parseBatchArguments(int argc, char** argv, BatchOptions& options) {
+    if (argc < 4 || std::string(argv[1]) != "--batch") {
+        return false;
+    }
+
+    options.inputFiles = collectInputFiles(argv[2]);
+    options.outputDir = argv[3];
+    options.jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "--jobs" || arg == "-j") && i + 1 < argc) {
+            options.jobs = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--merge-tolerance" && i + 1 < argc) {
+            options.planeMergeTolerance = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--simplify" && i + 1 < argc) {
+            options.simplifyTolerance = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--octree" && i + 1 < argc) {
+            options.octreeDepth = std::max(0, std::stoi(argv[++i]));
+        }
+        else if (arg == "--block-planes" && i + 1 < argc) {
+            options.octreeBlockPlanes = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--partition-threads" && i + 1 < argc) {
+            options.partitionThreads = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--facets" && i + 1 < argc) {
+            options.facets = argv[++i];
+            parseFacetExtraction(options.facets);  // Reject unknown modes up front
+        }
+        else if (arg == "--spill-limit" && i + 1 < argc) {
+            options.spillLimitMb = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--time-limit" && i + 1 < argc) {
+            options.timeLimitSeconds = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--memory-limit" && i + 1 < argc) {
+            options.memoryLimitMb = std::max(0.0, std::stod(argv[++i]));
+        }
+        else {
+            throw std::runtime_error("Unknown batch argument: " + arg);
+        }
+    }
+
+    return true;
+}
+
+BatchFileResult processContourFile(PipelineContext& pipeline, const std::string& filePath,
+                                   const std::string& outputDir) {
+    BatchFileResult result;
+    result.file = filePath;
+
+    try {
+        TRACE_SCOPE("processContourFile");
+        PipelineResult scene = pipeline.run(filePath);
+        const SpacePartitioner& partitioner = *scene.partitioner;
+        const Projection& projection = *scene.projection;
+
+        result.planeCount = scene.contourPlanes.size();
+        result.savedSplits = partitioner.getSavedSplits();
+        result.contourVertices = scene.simplification.inputVertices;
+        result.simplifiedVertices = scene.simplification.outputVertices;
+        result.cellCount = partitioner.getConvexCells().size();
+        result.uniformCells = projection.getUniformCellCount();
+        result.spilledPieces = partitioner.getSpilledPieces();
+        result.cellsFromCache = scene.timings.cellsFromCache;
+        result.parseMs = scene.timings.parseMs;
+        result.partitionMs = scene.timings.partitionMs;
+        result.reconstructionMs = scene.timings.projectionMs;
+        result.memory = scene.memory;
+        for (const auto& cellProj : projection.getCellProjections()) {
+            for (const auto& proj : cellProj.projections) {
+                result.meshCount++;
+                result.vertexCount += proj.reconstructedSurface->vertices.size();
+                result.triangleCount += proj.reconstructedSurface->triangles.size();
+            }
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        std::string meshPath = outputDir + "/" + fs::path(filePath).stem().string() + ".off";
+        if (!projection.saveReconstructedSurfaces(meshPath)) {
+            throw std::runtime_error("Could not write " + meshPath);
+        }
+        result.exportMs = elapsedMs(start);
+
+        result.success = true;
+    }
+    catch (const std::exception& e) {
+        result.error = e.what();
+    }
+
+    return result;
+}
+
+int runBatch(const BatchOptions& options) {
+    if (options.inputFiles.empty()) {
+        std::cerr << "No contour files to process" << std::endl;
+        return -1;
+    }
+    fs::create_directories(options.outputDir);
+
+    std::vector<BatchFileResult> results(options.inputFiles.size());
+    std::atomic<size_t> nextFile{0};
+    size_t jobs = std::min(options.jobs, options.inputFiles.size());
+
+    // Parallelism is across files, so each job runs its cells on its own thread;
+    // octree blocks get a share of the hardware threads unless told otherwise
+    PipelineOptions pipelineOptions;
+    pipelineOptions.cacheDir = options.outputDir + "/convex_cells";
+    pipelineOptions.threads = 1;
+    pipelineOptions.planeMergeTolerance = options.planeMergeTolerance;
+    pipelineOptions.simplifyTolerance = options.simplifyTolerance;
+    pipelineOptions.octreeDepth = options.octreeDepth;
+    pipelineOptions.octreeBlockPlanes = options.octreeBlockPlanes;
+    if (options.octreeDepth > 0) {
+        size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        pipelineOptions.partitionThreads = options.partitionThreads > 0 ? options.partitionThreads
+                                                                        : std::max<size_t>(1, hardwareThreads / jobs);
+    }
+    pipelineOptions.facetExtraction = parseFacetExtraction(options.facets);
+    pipelineOptions.spillLimitBytes = static_cast<int64_t>(options.spillLimitMb * 1024.0 * 1024.0);
+    pipelineOptions.budget.maxMs = options.timeLimitSeconds * 1000.0;
+    pipelineOptions.budget.maxHeapBytes = static_cast<int64_t>(options.memoryLimitMb * 1024.0 * 1024.0);
+
+    auto worker = [&]() {
+        setTraceThreadName("batch worker");
+        PipelineContext pipeline(pipelineOptions);
+        for (size_t i = nextFile++; i < options.inputFiles.size(); i = nextFile++) {
+            results[i] = processContourFile(pipeline, options.inputFiles[i], options.outputDir);
+
+            std::lock_guard<std::mutex> lock(g_logMutex);
+            const auto& r = results[i];
+            if (r.success) {
+                std::cout << "Processed " << r.file << ": " << r.cellCount << " cells, "
+                          << r.triangleCount << " triangles" << std::endl;
+            } else {
+                std::cerr << "Failed " << r.file << ": " << r.error << std::endl;
+            }
+        }
+    };
+
+    std::cout << "Processing " << options.inputFiles.size() << " files with "
+              << jobs << " jobs" << std::endl;
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < jobs; i++) {
+        workers.emplace_back(worker);
+    }
+    for (auto& t : workers) {
+        t.join();
+    }
+
+    writeSummary(options.outputDir + "/summary.csv", results);
+
+    size_t failures = 0;
+    int64_t peakBytes = 0;
+    for (const auto& r : results) {
+        if (!r.success) failures++;
+        peakBytes = std::max(peakBytes, r.memory.totalPeakBytes);
+    }
+    std::cout << "Batch finished: " << results.size() - failures << " succeeded, "
+              << failures << " failed" << std::endl;
+    std::cout << "Largest per-file peak heap: " << toMegabytes(peakBytes) << " MB" << std::endl;
+    return failures == 0 ? 0 : 1;
+}
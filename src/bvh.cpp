@@ -0,0 +1,140 @@
+// bvh.cpp
+#include "bvh.h"
+#include <algorithm>
+
+Frustum Frustum::fromMatrix(const float* m) {
+    // Row i of the column-major matrix is (m[i], m[4+i], m[8+i], m[12+i])
+    auto row = [m](int i) {
+        return std::array<double, 4>{m[i], m[4 + i], m[8 + i], m[12 + i]};
+    };
+    auto r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    Frustum frustum;
+    for (int k = 0; k < 4; k++) {
+        frustum.m_planes[0][k] = r3[k] + r0[k];  // Left
+        frustum.m_planes[1][k] = r3[k] - r0[k];  // Right
+        frustum.m_planes[2][k] = r3[k] + r1[k];  // Bottom
+        frustum.m_planes[3][k] = r3[k] - r1[k];  // Top
+        frustum.m_planes[4][k] = r3[k] + r2[k];  // Near
+        frustum.m_planes[5][k] = r3[k] - r2[k];  // Far
+    }
+    return frustum;
+}
+
+Frustum::Containment Frustum::classify(const CGAL::Bbox_3& box) const {
+    Containment result = Containment::Inside;
+    for (const auto& p : m_planes) {
+        // Box corners furthest along and against the plane normal
+        double maxDist = p[0] * (p[0] > 0 ? box.xmax() : box.xmin()) +
+                         p[1] * (p[1] > 0 ? box.ymax() : box.ymin()) +
+                         p[2] * (p[2] > 0 ? box.zmax() : box.zmin()) + p[3];
+        if (maxDist < 0) return Containment::Outside;
+
+        double minDist = p[0] * (p[0] > 0 ? box.xmin() : box.xmax()) +
+                         p[1] * (p[1] > 0 ? box.ymin() : box.ymax()) +
+                         p[2] * (p[2] > 0 ? box.zmin() : box.zmax()) + p[3];
+        if (minDist < 0) result = Containment::Intersecting;
+    }
+    return result;
+}
+
+void BoundingVolumeHierarchy::build(const std::vector<CGAL::Bbox_3>& boxes) {
+    m_nodes.clear();
+    m_boxes = boxes;
+    m_items.resize(boxes.size());
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+        m_items[i] = i;
+    }
+    if (boxes.empty()) return;
+
+    m_nodes.reserve(2 * boxes.size() / LEAF_SIZE + 1);
+    buildNode(boxes, 0, static_cast<uint32_t>(boxes.size()));
+}
+
+uint32_t BoundingVolumeHierarchy::buildNode(const std::vector<CGAL::Bbox_3>& boxes,
+                                            uint32_t first, uint32_t count) {
+    uint32_t nodeIndex = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+
+    CGAL::Bbox_3 box;
+    CGAL::Bbox_3 centroids;
+    for (uint32_t i = first; i < first + count; i++) {
+        const CGAL::Bbox_3& b = boxes[m_items[i]];
+        box += b;
+        double cx = (b.xmin() + b.xmax()) / 2;
+        double cy = (b.ymin() + b.ymax()) / 2;
+        double cz = (b.zmin() + b.zmax()) / 2;
+        centroids += CGAL::Bbox_3(cx, cy, cz, cx, cy, cz);
+    }
+    m_nodes[nodeIndex].box = box;
+
+    if (count <= LEAF_SIZE) {
+        m_nodes[nodeIndex].first = first;
+        m_nodes[nodeIndex].count = count;
+        return nodeIndex;
+    }
+
+    // Median split along the axis with the widest centroid spread
+    int axis = 0;
+    double extent = centroids.xmax() - centroids.xmin();
+    for (int a = 1; a < 3; a++) {
+        double e = centroids.max(a) - centroids.min(a);
+        if (e > extent) {
+            extent = e;
+            axis = a;
+        }
+    }
+
+    uint32_t half = count / 2;
+    std::nth_element(m_items.begin() + first, m_items.begin() + first + half,
+                     m_items.begin() + first + count,
+                     [&](uint32_t a, uint32_t b) {
+                         return boxes[a].min(axis) + boxes[a].max(axis) <
+                                boxes[b].min(axis) + boxes[b].max(axis);
+                     });
+
+    uint32_t left = buildNode(boxes, first, half);
+    uint32_t right = buildNode(boxes, first + half, count - half);
+    m_nodes[nodeIndex].left = left;
+    m_nodes[nodeIndex].right = right;
+    return nodeIndex;
+}
+
+void BoundingVolumeHierarchy::collect(uint32_t nodeIndex, std::vector<uint32_t>& visible) const {
+    const Node& node = m_nodes[nodeIndex];
+    if (node.count > 0) {
+        visible.insert(visible.end(), m_items.begin() + node.first,
+                       m_items.begin() + node.first + node.count);
+        return;
+    }
+    collect(node.left, visible);
+    collect(node.right, visible);
+}
+
+void BoundingVolumeHierarchy::query(const Frustum& frustum, std::vector<uint32_t>& visible) const {
+    if (m_nodes.empty()) return;
+
+    std::vector<uint32_t> stack = {0};
+    while (!stack.empty()) {
+        uint32_t nodeIndex = stack.back();
+        stack.pop_back();
+        const Node& node = m_nodes[nodeIndex];
+
+        Frustum::Containment containment = frustum.classify(node.box);
+        if (containment == Frustum::Containment::Outside) continue;
+        if (containment == Frustum::Containment::Inside) {
+            collect(nodeIndex, visible);
+            continue;
+        }
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; i++) {
+                if (frustum.classify(m_boxes[m_items[i]]) != Frustum::Containment::Outside) {
+                    visible.push_back(m_items[i]);
+                }
+            }
+            continue;
+        }
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
@@ -12,6 +12,10 @@ float cameraRadius = 10.0f;  // Initial radius
 float lastX = 400.0f, lastY = 300.0f;
 bool firstMouse = true;
 bool leftMouseButtonPressed = false;
+bool cameraChanged = false;
+
+static glm::mat4 s_projectionMatrix(1.0f);
+static glm::mat4 s_viewMatrix(1.0f);
 
 const float MIN_RADIUS = 2.0f;
 const float MAX_RADIUS = 50.0f;
@@ -21,25 +25,36 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     // Zoom with scroll wheel
     cameraRadius -= yoffset * ZOOM_SPEED;
     cameraRadius = std::clamp(cameraRadius, MIN_RADIUS, MAX_RADIUS);
+    cameraChanged = true;
 }
 
-void process_keyboard(GLFWwindow* window) {
+bool process_keyboard(GLFWwindow* window) {
     // Zoom with keyboard
+    float previousRadius = cameraRadius;
+    bool held = false;
     if (glfwGetKey(window, GLFW_KEY_EQUAL) == GLFW_PRESS) {
         cameraRadius -= ZOOM_SPEED;
+        held = true;
     }
     if (glfwGetKey(window, GLFW_KEY_MINUS) == GLFW_PRESS) {
         cameraRadius += ZOOM_SPEED;
+        held = true;
     }
     cameraRadius = std::clamp(cameraRadius, MIN_RADIUS, MAX_RADIUS);
+    if (cameraRadius != previousRadius) {
+        cameraChanged = true;
+    }
+    return held;
 }
 
 void updateCamera() {
-    glLoadIdentity();
     float camX = cameraRadius * cos(glm::radians(cameraYaw)) * cos(glm::radians(cameraPitch));
     float camY = cameraRadius * sin(glm::radians(cameraPitch));
     float camZ = cameraRadius * sin(glm::radians(cameraYaw)) * cos(glm::radians(cameraPitch));
-    gluLookAt(camX, camY, camZ, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);
+    s_viewMatrix = glm::lookAt(glm::vec3(camX, camY, camZ),
+                               glm::vec3(0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+    glLoadMatrixf(glm::value_ptr(s_viewMatrix));
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -77,6 +92,8 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
             cameraPitch = 89.0f;
         if (cameraPitch < -89.0f)
             cameraPitch = -89.0f;
+
+        cameraChanged = true;
     } else {
         lastX = xpos;
         lastY = ypos;
@@ -84,9 +101,15 @@ void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 void setupProjection(int width, int height) {
+    s_projectionMatrix = glm::perspective(glm::radians(45.0f),
+                                          (float)width / (float)std::max(height, 1),
+                                          0.1f, 100.0f);
     glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(45.0, (double)width / (double)height, 0.1, 100.0);
+    glLoadMatrixf(glm::value_ptr(s_projectionMatrix));
     glMatrixMode(GL_MODELVIEW);
     glLoadIdentity();
+}
+
+glm::mat4 getViewProjectionMatrix() {
+    return s_projectionMatrix * s_viewMatrix;
 }
\ No newline at end of file
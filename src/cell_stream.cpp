@@ -0,0 +1,22 @@
+// cell_stream.cpp
+#include "cell_stream.h"
+#include <utility>
+
+void CellStream::begin(const std::vector<ContourPlane>& contourPlanes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.started = true;
+    m_pending.contourPlanes = contourPlanes;
+    m_pending.cells.clear();
+}
+
+void CellStream::push(StreamedCell cell) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pending.cells.push_back(std::move(cell));
+}
+
+CellStreamBatch CellStream::drain() {
+    CellStreamBatch batch;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::swap(batch, m_pending);
+    return batch;
+}
@@ -1,19 +1,71 @@
 // contour.cpp
 #include "contour.h"
+#include "memory_stats.h"
+#include "trace.h"
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <string>
 
+ContourStoreBuilder::ContourStoreBuilder(const std::string& filename)
+    : m_store(std::make_shared<ContourStore>()) {
+    m_store->filename = filename;
+}
+
+void ContourStoreBuilder::beginPlane(const Plane& plane) {
+    ContourStore::PlaneRecord record;
+    record.plane = plane;
+    record.firstVertex = static_cast<uint32_t>(m_store->x.size());
+    record.firstEdge = static_cast<uint32_t>(m_store->edges.size());
+    m_store->planes.push_back(record);
+}
+
+void ContourStoreBuilder::addVertex(const Point& p) {
+    m_store->x.push_back(p.x());
+    m_store->y.push_back(p.y());
+    m_store->z.push_back(p.z());
+    m_store->planes.back().vertexCount++;
+}
+
+void ContourStoreBuilder::addEdge(uint32_t v1, uint32_t v2, int32_t m1, int32_t m2) {
+    m_store->edges.push_back({v1, v2});
+    m_store->edgeMaterials.push_back({m1, m2});
+    m_store->planes.back().edgeCount++;
+}
+
+void ContourStoreBuilder::setExtendedMesh(ExtendedMesh mesh) {
+    m_store->planes.back().extMesh = static_cast<int32_t>(m_store->extMeshes.size());
+    m_store->extMeshes.push_back(std::move(mesh));
+}
+
+std::vector<ContourPlane> ContourStoreBuilder::build() {
+    // Parsing grows the arrays geometrically; trim them once they are final
+    m_store->x.shrink_to_fit();
+    m_store->y.shrink_to_fit();
+    m_store->z.shrink_to_fit();
+    m_store->edges.shrink_to_fit();
+    m_store->edgeMaterials.shrink_to_fit();
+
+    std::shared_ptr<const ContourStore> store = std::move(m_store);
+    std::vector<ContourPlane> planes;
+    planes.reserve(store->planes.size());
+    for (uint32_t i = 0; i < store->planes.size(); i++) {
+        planes.emplace_back(store, i);
+    }
+    return planes;
+}
+
 std::vector<ContourPlane> parseContourFile(const std::string &filePath)
 {
+    TRACE_SCOPE("parseContourFile");
+    MemoryStageScope memoryStage(MemoryStage::Parse);
     std::ifstream file(filePath);
     if (!file.is_open())
     {
         throw std::runtime_error("Could not open file");
     }
 
-    std::vector<ContourPlane> contourPlanes;
+    ContourStoreBuilder builder(filePath);
     int numPlanes;
     file >> numPlanes;
 
@@ -21,12 +73,7 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
     {
         float a, b, c, d;
         file >> a >> b >> c >> d;
-        Plane plane(a, b, c, d);
-
-        ContourPlane contourPlane;
-        contourPlane.filename = filePath;
-        contourPlane.plane = plane;
-        contourPlane.hasExt = false;
+        builder.beginPlane(Plane(a, b, c, d));
 
         int numVertices, numEdges;
         file >> numVertices >> numEdges;
@@ -35,14 +82,15 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
         {
             float x, y, z;
             file >> x >> y >> z;
-            contourPlane.vertices.emplace_back(x, y, z);
+            builder.addVertex(Point(x, y, z));
         }
 
+        // Negative indices wrap around and fail the range checks of every consumer
         for (int j = 0; j < numEdges; ++j)
         {
             int v1, v2, m1, m2;
             file >> v1 >> v2 >> m1 >> m2;
-            contourPlane.edges.emplace_back(v1, v2);
+            builder.addEdge(static_cast<uint32_t>(v1), static_cast<uint32_t>(v2), m1, m2);
         }
 
         // Read potential whitespace and next character
@@ -53,6 +101,7 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
             if (marker == '~')
             {
                 std::cout << "Found extended mesh data" << std::endl;
+                ExtendedMesh extMesh;
                 int numVerts, numFaces;
                 file >> numVerts >> numFaces;
 
@@ -61,7 +110,7 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
                 {
                     float x, y, z;
                     file >> x >> y >> z;
-                    contourPlane.extMesh.vertices.emplace_back(x, y, z);
+                    extMesh.vertices.emplace_back(x, y, z);
                 }
 
                 // Read faces
@@ -69,7 +118,7 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
                 {
                     ExtendedMesh::Face face;
                     file >> face.v1 >> face.v2 >> face.v3 >> face.materialPos >> face.materialNeg;
-                    contourPlane.extMesh.faces.push_back(face);
+                    extMesh.faces.push_back(face);
                 }
 
                 // Read number of contour edges
@@ -81,10 +130,10 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
                 {
                     size_t v1, v2;
                     file >> v1 >> v2;
-                    contourPlane.extMesh.contourEdges.emplace_back(v1, v2);
+                    extMesh.contourEdges.emplace_back(v1, v2);
                 }
 
-                contourPlane.hasExt = true;
+                builder.setExtendedMesh(std::move(extMesh));
             }
             else
             {
@@ -92,28 +141,7 @@ std::vector<ContourPlane> parseContourFile(const std::string &filePath)
                 file.unget();
             }
         }
-
-        contourPlanes.push_back(contourPlane);
     }
 
-    return contourPlanes;
+    return builder.build();
 }
-
-void renderContourPlanes(const std::vector<ContourPlane> &contourPlanes)
-{
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    for (const auto &contourPlane : contourPlanes)
-    {
-        glColor3f(1.0f, 0.0f, 0.0f);
-        glBegin(GL_LINES);
-        for (const auto &edge : contourPlane.edges)
-        {
-            const Point &p1 = contourPlane.vertices[edge.first];
-            const Point &p2 = contourPlane.vertices[edge.second];
-            glVertex3f(p1.x(), p1.y(), p1.z());
-            glVertex3f(p2.x(), p2.y(), p2.z());
-        }
-        glEnd();
-    }
-}
\ No newline at end of file
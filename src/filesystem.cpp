@@ -1,5 +1,6 @@
 // filesystem.cpp
 #include "filesystem.h"
+#include "timing.h"
 #include <stdexcept>
 #include <algorithm>
 #include <filesystem>
@@ -47,7 +48,9 @@ bool FileSystem::selectFile(size_t index) {
 
 void FileSystem::loadCurrentFile() {
     if (!m_files.empty()) {
+        auto start = std::chrono::steady_clock::now();
         m_currentContours = loadContourFile(m_files[m_currentIndex]);
+        m_lastParseMs = elapsedMs(start);
     }
 }
 
@@ -0,0 +1,516 @@
+// generator.cpp
+#include "generator.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace {
+
+using Vec3 = std::array<double, 3>;
+using Vec2 = std::array<double, 2>;
+using Loop = std::vector<Vec2>;
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int SLICE_GRID = 160;  // Marching squares cells per side
+
+Vec3 operator+(const Vec3& a, const Vec3& b) { return {a[0] + b[0], a[1] + b[1], a[2] + b[2]}; }
+Vec3 operator-(const Vec3& a, const Vec3& b) { return {a[0] - b[0], a[1] - b[1], a[2] - b[2]}; }
+Vec3 operator*(const Vec3& a, double s) { return {a[0] * s, a[1] * s, a[2] * s}; }
+double dot(const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+double length(const Vec3& a) { return std::sqrt(dot(a, a)); }
+Vec3 cross(const Vec3& a, const Vec3& b) {
+    return {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+}
+Vec3 normalize(const Vec3& a) { return a * (1.0 / length(a)); }
+
+// Implicit shape, negative inside
+struct Shape {
+    std::function<double(const Vec3&)> field;
+    double boundingRadius;
+};
+
+double segmentDistance(const Vec3& p, const Vec3& a, const Vec3& b) {
+    Vec3 ab = b - a;
+    double t = std::clamp(dot(p - a, ab) / dot(ab, ab), 0.0, 1.0);
+    return length(p - (a + ab * t));
+}
+
+Shape makeShape(const std::string& name, std::mt19937& rng) {
+    if (name == "torus") {
+        const double major = 3.0, minor = 1.0;
+        return {[=](const Vec3& p) {
+                    return std::hypot(std::hypot(p[0], p[1]) - major, p[2]) - minor;
+                }, 4.5};
+    }
+    if (name == "branch") {
+        // Trunk along z splitting into three tubes
+        const std::vector<std::pair<Vec3, Vec3>> segments = {
+            {{0.0, 0.0, -4.0}, {0.0, 0.0, 0.0}},
+            {{0.0, 0.0, 0.0}, {2.5, 0.0, 3.5}},
+            {{0.0, 0.0, 0.0}, {-1.25, 2.2, 3.5}},
+            {{0.0, 0.0, 0.0}, {-1.25, -2.2, 3.5}}};
+        const double radius = 0.8;
+        return {[=](const Vec3& p) {
+                    double d = std::numeric_limits<double>::max();
+                    for (const auto& [a, b] : segments) {
+                        d = std::min(d, segmentDistance(p, a, b) - radius);
+                    }
+                    return d;
+                }, 5.5};
+    }
+    if (name == "blob") {
+        // Metaballs along a random walk so the blob stays connected
+        std::uniform_real_distribution<double> unit(-1.0, 1.0);
+        std::vector<Vec3> centers = {{0.0, 0.0, 0.0}};
+        while (centers.size() < 6) {
+            Vec3 step = {unit(rng), unit(rng), unit(rng)};
+            if (length(step) < 1e-3) continue;
+            Vec3 next = centers.back() + normalize(step) * 1.0;
+            if (length(next) < 2.5) centers.push_back(next);
+        }
+        return {[=](const Vec3& p) {
+                    double sum = 0.0;
+                    for (const auto& c : centers) {
+                        Vec3 d = p - c;
+                        sum += std::exp(-dot(d, d) / 1.2);
+                    }
+                    return 0.4 - sum;
+                }, 5.0};
+    }
+    throw std::runtime_error("Unknown shape: " + name + " (expected torus, branch or blob)");
+}
+
+// Plane normal . p = offset, the convention of the .contour format
+struct SlicePlane {
+    Vec3 normal;
+    double offset;
+    Vec3 u, v;  // In-plane axes with u x v = normal
+    std::vector<Loop> loops;
+
+    SlicePlane(const Vec3& n, double d) : normal(normalize(n)), offset(d) {
+        Vec3 helper = std::abs(normal[0]) < 0.9 ? Vec3{1.0, 0.0, 0.0} : Vec3{0.0, 1.0, 0.0};
+        u = normalize(cross(helper, normal));
+        v = cross(normal, u);
+    }
+
+    Vec3 toWorld(const Vec2& q) const { return normal * offset + u * q[0] + v * q[1]; }
+};
+
+// Closed section loops by marching squares, oriented with the inside on the left
+std::vector<Loop> sliceShape(const Shape& shape, const SlicePlane& plane) {
+    const int n = SLICE_GRID + 1;
+    const double step = 2.0 * shape.boundingRadius / SLICE_GRID;
+    auto coord = [&](int i) { return -shape.boundingRadius + i * step; };
+
+    std::vector<double> values(static_cast<size_t>(n) * n);
+    for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+            double f = shape.field(plane.toWorld({coord(i), coord(j)}));
+            values[j * n + i] = (f == 0.0) ? 1e-12 : f;  // Keep every crossing strict
+        }
+    }
+
+    // Crossings are keyed by grid edge: 2*node for the edge to +x, 2*node+1 to +y
+    std::unordered_map<size_t, Vec2> points;
+    std::unordered_map<size_t, size_t> next;
+
+    auto crossing = [&](int i0, int j0, int i1, int j1) {
+        size_t a = j0 * n + i0, b = j1 * n + i1;
+        size_t key = 2 * a + (j1 != j0 ? 1 : 0);
+        if (!points.count(key)) {
+            double t = values[a] / (values[a] - values[b]);
+            points[key] = {coord(i0) + (i1 - i0) * step * t, coord(j0) + (j1 - j0) * step * t};
+        }
+        return key;
+    };
+
+    for (int j = 0; j < SLICE_GRID; j++) {
+        for (int i = 0; i < SLICE_GRID; i++) {
+            const std::array<std::array<int, 2>, 4> corners = {{{i, j}, {i + 1, j}, {i + 1, j + 1}, {i, j + 1}}};
+            std::array<double, 4> f;
+            std::array<bool, 4> inside;
+            int insideCount = 0;
+            for (int k = 0; k < 4; k++) {
+                f[k] = values[corners[k][1] * n + corners[k][0]];
+                inside[k] = f[k] < 0.0;
+                insideCount += inside[k];
+            }
+            if (insideCount == 0 || insideCount == 4) continue;
+
+            // Edge k joins corner k and corner k+1
+            auto edgeKey = [&](int k) {
+                const auto& a = corners[k];
+                const auto& b = corners[(k + 1) % 4];
+                // Key by the lower corner so neighbouring cells agree
+                if (a[0] + a[1] <= b[0] + b[1]) return crossing(a[0], a[1], b[0], b[1]);
+                return crossing(b[0], b[1], a[0], a[1]);
+            };
+            auto cornerPoint = [&](int k) { return Vec2{coord(corners[k][0]), coord(corners[k][1])}; };
+
+            auto addSegment = [&](size_t a, size_t b, const Vec2& insidePoint) {
+                const Vec2& pa = points[a];
+                const Vec2& pb = points[b];
+                double side = (pb[0] - pa[0]) * (insidePoint[1] - pa[1]) -
+                              (pb[1] - pa[1]) * (insidePoint[0] - pa[0]);
+                if (side < 0) std::swap(a, b);
+                next[a] = b;
+            };
+
+            bool saddle = insideCount == 2 && inside[0] == inside[2];
+            if (saddle) {
+                // The centre value decides whether the inside corners connect
+                bool centreInside = (f[0] + f[1] + f[2] + f[3]) < 0.0;
+                Vec2 centre = {coord(i) + step / 2, coord(j) + step / 2};
+                for (int k = 0; k < 4; k++) {
+                    if (inside[k] == centreInside) continue;  // Corner is not cut off
+                    size_t a = edgeKey((k + 3) % 4);
+                    size_t b = edgeKey(k);
+                    addSegment(a, b, inside[k] ? cornerPoint(k) : centre);
+                }
+                continue;
+            }
+
+            std::vector<size_t> keys;
+            Vec2 insideCentroid = {0.0, 0.0};
+            for (int k = 0; k < 4; k++) {
+                if (inside[k] != inside[(k + 1) % 4]) keys.push_back(edgeKey(k));
+                if (inside[k]) {
+                    Vec2 c = cornerPoint(k);
+                    insideCentroid[0] += c[0] / insideCount;
+                    insideCentroid[1] += c[1] / insideCount;
+                }
+            }
+            addSegment(keys[0], keys[1], insideCentroid);
+        }
+    }
+
+    // Chain directed segments into loops; open chains touch the grid border and are dropped
+    std::vector<Loop> loops;
+    std::unordered_set<size_t> visited;
+    for (const auto& [start, unused] : next) {
+        if (visited.count(start)) continue;
+        Loop loop;
+        size_t key = start;
+        bool closed = false;
+        while (!visited.count(key)) {
+            visited.insert(key);
+            loop.push_back(points[key]);
+            auto it = next.find(key);
+            if (it == next.end()) break;
+            key = it->second;
+            closed = key == start;
+        }
+        if (closed && loop.size() >= 4) {
+            loops.push_back(std::move(loop));
+        }
+    }
+
+    // Deterministic order for stable output: by first point
+    std::sort(loops.begin(), loops.end(), [](const Loop& a, const Loop& b) {
+        return *std::min_element(a.begin(), a.end()) < *std::min_element(b.begin(), b.end());
+    });
+    return loops;
+}
+
+// Evenly spaced by arc length, starting from the lexicographically smallest point
+Loop resampleLoop(const Loop& loop, size_t count) {
+    size_t first = std::min_element(loop.begin(), loop.end()) - loop.begin();
+    std::vector<double> cumulative(loop.size() + 1, 0.0);
+    for (size_t k = 0; k < loop.size(); k++) {
+        const Vec2& a = loop[(first + k) % loop.size()];
+        const Vec2& b = loop[(first + k + 1) % loop.size()];
+        cumulative[k + 1] = cumulative[k] + std::hypot(b[0] - a[0], b[1] - a[1]);
+    }
+
+    Loop result;
+    result.reserve(count);
+    size_t segment = 0;
+    for (size_t k = 0; k < count; k++) {
+        double target = cumulative.back() * k / count;
+        while (cumulative[segment + 1] < target) segment++;
+        const Vec2& a = loop[(first + segment) % loop.size()];
+        const Vec2& b = loop[(first + segment + 1) % loop.size()];
+        double span = cumulative[segment + 1] - cumulative[segment];
+        double t = span > 0 ? (target - cumulative[segment]) / span : 0.0;
+        result.push_back({a[0] + (b[0] - a[0]) * t, a[1] + (b[1] - a[1]) * t});
+    }
+    return result;
+}
+
+// Range along z where the shape has material, from a coarse scan
+std::pair<double, double> axialExtent(const Shape& shape) {
+    const int samples = 200, grid = 48;
+    double r = shape.boundingRadius;
+    double lo = std::numeric_limits<double>::max(), hi = std::numeric_limits<double>::lowest();
+    for (int k = 0; k <= samples; k++) {
+        double z = -r + 2.0 * r * k / samples;
+        bool hit = false;
+        for (int j = 0; j <= grid && !hit; j++) {
+            for (int i = 0; i <= grid && !hit; i++) {
+                hit = shape.field({-r + 2.0 * r * i / grid, -r + 2.0 * r * j / grid, z}) < 0.0;
+            }
+        }
+        if (hit) {
+            lo = std::min(lo, z);
+            hi = std::max(hi, z);
+        }
+    }
+    if (lo > hi) {
+        throw std::runtime_error("Shape has no material inside its bounds");
+    }
+    return {lo, hi};
+}
+
+std::vector<SlicePlane> choosePlanes(const Shape& shape, const GeneratorOptions& options, std::mt19937& rng) {
+    auto [lo, hi] = axialExtent(shape);
+    size_t obliqueCount = static_cast<size_t>(std::lround(options.planes * options.obliqueFraction));
+    size_t parallelCount = options.planes - obliqueCount;
+
+    std::vector<SlicePlane> planes;
+    for (size_t i = 0; i < parallelCount; i++) {
+        SlicePlane plane({0.0, 0.0, 1.0}, lo + (hi - lo) * (i + 1) / (parallelCount + 1));
+        plane.loops = sliceShape(shape, plane);
+        if (plane.loops.empty()) {
+            std::cerr << "Skipping empty slice at z = " << plane.offset << std::endl;
+            continue;
+        }
+        planes.push_back(std::move(plane));
+    }
+
+    std::uniform_real_distribution<double> tilt(20.0 * PI / 180.0, 70.0 * PI / 180.0);
+    std::uniform_real_distribution<double> azimuth(0.0, 2.0 * PI);
+    std::uniform_real_distribution<double> height(lo + 0.1 * (hi - lo), hi - 0.1 * (hi - lo));
+    for (size_t i = 0; i < obliqueCount; i++) {
+        bool placed = false;
+        for (int attempt = 0; attempt < 100 && !placed; attempt++) {
+            double t = tilt(rng), a = azimuth(rng);
+            Vec3 normal = {std::sin(t) * std::cos(a), std::sin(t) * std::sin(a), std::cos(t)};
+            SlicePlane plane(normal, normal[2] * height(rng));
+            plane.loops = sliceShape(shape, plane);
+            if (!plane.loops.empty()) {
+                planes.push_back(std::move(plane));
+                placed = true;
+            }
+        }
+        if (!placed) {
+            throw std::runtime_error("Could not place an oblique plane through the shape");
+        }
+    }
+    return planes;
+}
+
+// Mean distance between two equally sized loops for the best index rotation
+std::pair<double, size_t> loopDistance(const std::vector<Vec3>& a, const std::vector<Vec3>& b) {
+    double best = std::numeric_limits<double>::max();
+    size_t bestShift = 0;
+    for (size_t shift = 0; shift < b.size(); shift++) {
+        double sum = 0.0;
+        for (size_t k = 0; k < a.size(); k++) {
+            sum += length(a[k] - b[(k + shift) % b.size()]);
+        }
+        if (sum < best) {
+            best = sum;
+            bestShift = shift;
+        }
+    }
+    return {best / a.size(), bestShift};
+}
+
+struct WrittenPlane {
+    const SlicePlane* plane;
+    std::vector<std::vector<Vec3>> loops;  // Resampled, in world coordinates
+};
+
+void writeVertex(std::ostream& out, const Vec3& p) {
+    out << p[0] << " " << p[1] << " " << p[2] << "\n";
+}
+
+// Side wall between this slice and the next parallel one, as an extended-mesh block
+void writeExtendedMesh(std::ostream& out, const WrittenPlane& lower, const WrittenPlane& upper,
+                       const GeneratorOptions& options) {
+    std::vector<Vec3> vertices;
+    std::vector<std::array<size_t, 3>> faces;
+    std::vector<std::pair<size_t, size_t>> contourEdges;
+
+    for (const auto& ring : lower.loops) {
+        // Pair with the closest ring above; concentric rings are told apart by distance
+        const std::vector<Vec3>* match = nullptr;
+        std::pair<double, size_t> bestFit = {std::numeric_limits<double>::max(), 0};
+        for (const auto& candidate : upper.loops) {
+            auto fit = loopDistance(ring, candidate);
+            if (fit.first < bestFit.first) {
+                bestFit = fit;
+                match = &candidate;
+            }
+        }
+        if (!match) continue;
+
+        size_t base = vertices.size();
+        size_t count = ring.size();
+        vertices.insert(vertices.end(), ring.begin(), ring.end());
+        for (size_t k = 0; k < count; k++) {
+            vertices.push_back((*match)[(k + bestFit.second) % count]);
+        }
+        for (size_t k = 0; k < count; k++) {
+            size_t a0 = base + k, a1 = base + (k + 1) % count;
+            size_t b0 = a0 + count, b1 = a1 + count;
+            faces.push_back({a0, a1, b1});
+            faces.push_back({a0, b1, b0});
+            contourEdges.emplace_back(a0, a1);
+        }
+    }
+    if (faces.empty()) return;
+
+    // Faces wind outward, so the positive side is outside the shape
+    out << "~\n" << vertices.size() << " " << faces.size() << "\n";
+    for (const auto& p : vertices) writeVertex(out, p);
+    for (const auto& f : faces) {
+        out << f[0] << " " << f[1] << " " << f[2] << " "
+            << options.outsideMaterial << " " << options.insideMaterial << "\n";
+    }
+    out << contourEdges.size() << "\n";
+    for (const auto& [a, b] : contourEdges) out << a << " " << b << "\n";
+}
+
+std::vector<size_t> parseSizeList(const std::string& text) {
+    std::vector<size_t> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) values.push_back(std::stoul(item));
+    }
+    return values;
+}
+
+} // namespace
+
+bool parseGeneratorArguments(int argc, char** argv, GeneratorOptions& options) {
+    if (argc < 4 || std::string(argv[1]) != "--generate") {
+        return false;
+    }
+
+    options.shape = argv[2];
+    options.output = argv[3];
+    for (int i = 4; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--planes" && i + 1 < argc) {
+            options.planes = std::stoul(argv[++i]);
+        }
+        else if (arg == "--oblique" && i + 1 < argc) {
+            options.obliqueFraction = std::stod(argv[++i]);
+        }
+        else if (arg == "--vertices" && i + 1 < argc) {
+            options.verticesPerContour = std::stoul(argv[++i]);
+        }
+        else if (arg == "--ext") {
+            options.extendedMesh = true;
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            options.seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--series" && i + 1 < argc) {
+            options.series = parseSizeList(argv[++i]);
+        }
+        else {
+            throw std::runtime_error("Unknown generator argument: " + arg);
+        }
+    }
+
+    if (options.planes == 0 || options.verticesPerContour < 3 ||
+        options.obliqueFraction < 0.0 || options.obliqueFraction > 1.0) {
+        throw std::runtime_error("Invalid generator options: need --planes >= 1, "
+                                 "--vertices >= 3 and --oblique in [0, 1]");
+    }
+    return true;
+}
+
+size_t generateContourFile(const GeneratorOptions& options, const std::string& path) {
+    std::mt19937 rng(options.seed);
+    Shape shape = makeShape(options.shape, rng);
+    std::vector<SlicePlane> planes = choosePlanes(shape, options, rng);
+
+    std::vector<WrittenPlane> written;
+    for (const auto& plane : planes) {
+        WrittenPlane w{&plane, {}};
+        for (const auto& loop : plane.loops) {
+            std::vector<Vec3> ring;
+            for (const auto& q : resampleLoop(loop, options.verticesPerContour)) {
+                ring.push_back(plane.toWorld(q));
+            }
+            w.loops.push_back(std::move(ring));
+        }
+        written.push_back(std::move(w));
+    }
+
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    out << std::setprecision(9);
+    out << written.size() << "\n";
+
+    for (size_t p = 0; p < written.size(); p++) {
+        const WrittenPlane& w = written[p];
+        const SlicePlane& plane = *w.plane;
+        size_t vertexCount = 0;
+        for (const auto& ring : w.loops) vertexCount += ring.size();
+
+        out << plane.normal[0] << " " << plane.normal[1] << " " << plane.normal[2] << " "
+            << plane.offset << "\n";
+        out << vertexCount << " " << vertexCount << "\n";
+        for (const auto& ring : w.loops) {
+            for (const auto& v : ring) writeVertex(out, v);
+        }
+        // Loops run counter-clockwise about the normal around material, as in the bundled data
+        size_t base = 0;
+        for (const auto& ring : w.loops) {
+            for (size_t k = 0; k < ring.size(); k++) {
+                out << base + k << " " << base + (k + 1) % ring.size() << " "
+                    << options.outsideMaterial << " " << options.insideMaterial << "\n";
+            }
+            base += ring.size();
+        }
+
+        // Parallel slices come first in offset order, so the next one is directly above
+        bool nextIsParallelAbove = p + 1 < written.size() &&
+                                   plane.normal[2] == 1.0 && written[p + 1].plane->normal[2] == 1.0;
+        if (options.extendedMesh && nextIsParallelAbove) {
+            writeExtendedMesh(out, w, written[p + 1], options);
+        }
+    }
+
+    return written.size();
+}
+
+int runGenerator(const GeneratorOptions& options) {
+    std::vector<std::pair<std::string, size_t>> jobs;
+    if (options.series.empty()) {
+        jobs.emplace_back(options.output, options.planes);
+    } else {
+        fs::create_directories(options.output);
+        for (size_t planes : options.series) {
+            jobs.emplace_back(options.output + "/" + options.shape + "_" + std::to_string(planes) + ".contour",
+                              planes);
+        }
+    }
+
+    for (const auto& [path, planes] : jobs) {
+        GeneratorOptions fileOptions = options;
+        fileOptions.planes = planes;
+        size_t written = generateContourFile(fileOptions, path);
+        std::cout << "Wrote " << path << " with " << written << " planes" << std::endl;
+    }
+    return 0;
+}
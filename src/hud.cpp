@@ -0,0 +1,217 @@
+// hud.cpp
+#include "hud.h"
+#include "trace.h"
+#include <GL/freeglut.h>
+#include <algorithm>
+#include <cstdio>
+
+TextRenderer::~TextRenderer() {
+    if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_texture) glDeleteTextures(1, &m_texture);
+}
+
+void TextRenderer::init() {
+    if (m_texture) return;
+    glGenBuffers(1, &m_vbo);
+    buildAtlas();
+}
+
+void TextRenderer::buildAtlas() {
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_WIDTH, ATLAS_HEIGHT, 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    // Rasterize every printable glyph into the texture once through an FBO
+    GLuint fbo = 0;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLfloat clearColor[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+
+    glViewport(0, 0, ATLAS_WIDTH, ATLAS_HEIGHT);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, ATLAS_WIDTH, 0.0, ATLAS_HEIGHT, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glDisable(GL_DEPTH_TEST);
+
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    for (int i = 0; i < GLYPH_COUNT; i++) {
+        int col = i % ATLAS_COLUMNS;
+        int row = i / ATLAS_COLUMNS;
+        glRasterPos2i(col * CELL_WIDTH + 2, row * CELL_HEIGHT + GLYPH_DESCENT);
+        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, FIRST_GLYPH + i);
+        m_advance[i] = glutBitmapWidth(GLUT_BITMAP_HELVETICA_12, FIRST_GLYPH + i);
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextRenderer::addText(const std::string& text, float x, float y,
+                           const std::array<float, 3>& color) {
+    const float du = 1.0f / ATLAS_WIDTH;
+    const float dv = 1.0f / ATLAS_HEIGHT;
+
+    // y is the baseline in top-left origin screen coordinates
+    float penX = x;
+    for (char c : text) {
+        int glyph = static_cast<unsigned char>(c) - FIRST_GLYPH;
+        if (glyph < 0 || glyph >= GLYPH_COUNT) continue;
+
+        float u0 = (glyph % ATLAS_COLUMNS) * CELL_WIDTH * du;
+        float v0 = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT * dv;
+        float u1 = u0 + CELL_WIDTH * du;
+        float v1 = v0 + CELL_HEIGHT * dv;
+
+        float x0 = penX - 2.0f;
+        float x1 = x0 + CELL_WIDTH;
+        float top = y - (CELL_HEIGHT - GLYPH_DESCENT);
+        float bottom = y + GLYPH_DESCENT;
+
+        const float quad[4][4] = {
+            {x0, bottom, u0, v0},
+            {x1, bottom, u1, v0},
+            {x1, top, u1, v1},
+            {x0, top, u0, v1}
+        };
+        for (const auto& corner : quad) {
+            m_vertices.insert(m_vertices.end(),
+                              {corner[0], corner[1], corner[2], corner[3],
+                               color[0], color[1], color[2]});
+        }
+
+        penX += m_advance[glyph];
+    }
+}
+
+void TextRenderer::flush(int width, int height) {
+    TRACE_SCOPE("renderText");
+    m_lastDrawCalls = 0;
+    if (m_vertices.empty() || !m_texture) return;
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho(0.0, width, height, 0.0, -1.0, 1.0);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_TEXTURE_2D);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    glBindTexture(GL_TEXTURE_2D, m_texture);
+
+    const GLsizei stride = 7 * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(float),
+                 m_vertices.data(), GL_STREAM_DRAW);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT, stride, nullptr);
+    glTexCoordPointer(2, GL_FLOAT, stride, reinterpret_cast<void*>(2 * sizeof(float)));
+    glColorPointer(3, GL_FLOAT, stride, reinterpret_cast<void*>(4 * sizeof(float)));
+
+    glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(m_vertices.size() / 7));
+    m_lastDrawCalls = 1;
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_BLEND);
+    glDisable(GL_TEXTURE_2D);
+    glEnable(GL_DEPTH_TEST);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    m_vertices.clear();
+}
+
+PerformanceHud::PerformanceHud() : m_frameTimes(FRAME_HISTORY, 0.0) {}
+
+void PerformanceHud::recordFrame(double frameMs) {
+    m_frameTimes[m_nextFrame] = frameMs;
+    m_nextFrame = (m_nextFrame + 1) % FRAME_HISTORY;
+    m_recordedFrames = std::min(m_recordedFrames + 1, FRAME_HISTORY);
+}
+
+std::array<double, 3> PerformanceHud::computePercentiles() const {
+    if (m_recordedFrames == 0) return {0.0, 0.0, 0.0};
+
+    std::vector<double> sorted(m_frameTimes.begin(), m_frameTimes.begin() + m_recordedFrames);
+    std::sort(sorted.begin(), sorted.end());
+    auto at = [&](double q) {
+        return sorted[static_cast<size_t>(q * (sorted.size() - 1))];
+    };
+    return {at(0.50), at(0.95), at(0.99)};
+}
+
+void PerformanceHud::draw(TextRenderer& text, const RenderStats& stats, float x, float y) const {
+    const std::array<float, 3> color = {0.0f, 0.4f, 0.0f};
+    auto percentiles = computePercentiles();
+    char line[160];
+
+    std::snprintf(line, sizeof(line), "Frame: p50 %.2f ms  p95 %.2f ms  p99 %.2f ms",
+                  percentiles[0], percentiles[1], percentiles[2]);
+    text.addText(line, x, y, color);
+
+    std::snprintf(line, sizeof(line), "Draw calls: %zu  Triangles: %zu  Vertices: %zu",
+                  stats.drawCalls, stats.triangles, stats.vertices);
+    text.addText(line, x, y + 20.0f, color);
+
+    std::snprintf(line, sizeof(line), "Cells: %zu", m_cellCount);
+    text.addText(line, x, y + 40.0f, color);
+
+    std::snprintf(line, sizeof(line),
+                  "Last load: parse %.1f ms  partition %.1f ms%s  filter %.1f ms  projection %.1f ms",
+                  m_timings.parseMs, m_timings.partitionMs,
+                  m_timings.cellsFromCache ? " (cached)" : "",
+                  m_timings.filterMs, m_timings.projectionMs);
+    text.addText(line, x, y + 60.0f, color);
+
+    std::snprintf(line, sizeof(line), "Heap: live %.1f MB  load peak %.1f MB",
+                  toMegabytes(getMemoryReport().totalLiveBytes), toMegabytes(m_memory.totalPeakBytes));
+    text.addText(line, x, y + 80.0f, color);
+
+    std::snprintf(line, sizeof(line),
+                  "Stage peaks: parse %.1f  partition %.1f  filter %.1f  projection %.1f  triangulation %.1f MB",
+                  toMegabytes(m_memory.peak(MemoryStage::Parse)),
+                  toMegabytes(m_memory.peak(MemoryStage::Partition)),
+                  toMegabytes(m_memory.peak(MemoryStage::Filter)),
+                  toMegabytes(m_memory.peak(MemoryStage::Projection)),
+                  toMegabytes(m_memory.peak(MemoryStage::Triangulation)));
+    text.addText(line, x, y + 100.0f, color);
+}
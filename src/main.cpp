@@ -1,85 +1,153 @@
 #include <iostream>
-#include <sstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <GLFW/glfw3.h>
+#include <glm/gtc/type_ptr.hpp>
 #include "camera.h"
-#include "contour.h"
-#include "partition.h"
 #include "filesystem.h"
-#include "projection.h"
+#include "pipeline.h"
+#include "batch.h"
+#include "generator.h"
+#include "offscreen.h"
+#include "render.h"
+#include "hud.h"
+#include "memory_stats.h"
+#include "timing.h"
+#include "trace.h"
 
 // Global state variables
 bool g_showConvexCells = false;
 bool g_showSurfaceMeshes = false;
+bool g_showPerformanceHud = false;
+bool g_continuousRendering = false;  // Redraw every iteration instead of on demand
+bool g_needsRedraw = true;
+size_t g_fileCount = 0;
+size_t g_targetFile = 0;             // File shown or currently loading
+int g_requestedFile = -1;            // Pending switch, -1 when none
+int g_highlightedCell = -1;          // -1 when no cell is highlighted
+size_t g_cellCount = 0;
+
+// Queues the controls help into the text batch
+void renderHelpOverlay(TextRenderer& text) {
+    const std::string lines[] = {
+        "Controls:",
+        "Left/Right Arrow: Switch files",
+        "1-4: Select file directly",
+        std::string("C: Toggle convex cells (") + (g_showConvexCells ? "ON" : "OFF") + ")",
+        std::string("S: Toggle surface meshes (") + (g_showSurfaceMeshes ? "ON" : "OFF") + ")",
+        std::string("P: Toggle performance HUD (") + (g_showPerformanceHud ? "ON" : "OFF") + ")",
+        std::string("R: Toggle continuous rendering (") + (g_continuousRendering ? "ON" : "OFF") + ")",
+        "H: Highlight next convex cell",
+        "Mouse: Look around",
+        "Scroll: Zoom",
+        "ESC: Exit"
+    };
 
-// Text rendering helpers
-void renderText(const std::string& text, float x, float y) {
-    glMatrixMode(GL_PROJECTION);
-    glPushMatrix();
-    glLoadIdentity();
-    
-    int width, height;
-    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
-    glOrtho(0.0, width, height, 0.0, -1.0, 1.0);
-    
-    glMatrixMode(GL_MODELVIEW);
-    glPushMatrix();
-    glLoadIdentity();
-    
-    glDisable(GL_DEPTH_TEST);
-    glColor3f(0.0f, 0.0f, 0.0f);
-    
-    glRasterPos2f(x, y);
-    for (const char& c : text) {
-        glutBitmapCharacter(GLUT_BITMAP_HELVETICA_12, c);
+    float y = 20.0f;
+    for (const auto& line : lines) {
+        text.addText(line, 20.0f, y);
+        y += 20.0f;
     }
-    
-    glEnable(GL_DEPTH_TEST);
-    glMatrixMode(GL_PROJECTION);
-    glPopMatrix();
-    glMatrixMode(GL_MODELVIEW);
-    glPopMatrix();
 }
 
-void renderHelpOverlay() {
-    std::stringstream ss;
-    ss << "Controls:" << std::endl
-       << "Left/Right Arrow: Switch files" << std::endl
-       << "1-4: Select file directly" << std::endl
-       << "C: Toggle convex cells (" << (g_showConvexCells ? "ON" : "OFF") << ")" << std::endl
-       << "S: Toggle surface meshes (" << (g_showSurfaceMeshes ? "ON" : "OFF") << ")" << std::endl
-       << "Mouse: Look around" << std::endl
-       << "Scroll: Zoom" << std::endl
-       << "ESC: Exit";
+// Pipeline output for one file; built off the render thread on file switches
+struct LoadedScene : PipelineResult {
+    size_t fileIndex = 0;
+};
+
+// Builds partitioner and projection for freshly parsed contours
+std::unique_ptr<LoadedScene> buildScene(PipelineContext& pipeline, size_t fileIndex,
+                                        std::vector<ContourPlane> contourPlanes, double parseMs,
+                                        const RunHooks& hooks = RunHooks()) {
+    auto scene = std::make_unique<LoadedScene>();
+    static_cast<PipelineResult&>(*scene) = pipeline.run(std::move(contourPlanes), parseMs, hooks);
+    scene->fileIndex = fileIndex;
+    return scene;
+}
 
-    float y = 20.0f;
-    std::string line;
-    std::istringstream iss(ss.str());
-    while (std::getline(iss, line)) {
-        renderText(line, 20.0f, y);
-        y += 20.0f;
+void requestFile(size_t index) {
+    if (index < g_fileCount) {
+        g_requestedFile = static_cast<int>(index);
     }
 }
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
-    if (action == GLFW_PRESS) {
-        switch (key) {
-            case GLFW_KEY_C:
-                g_showConvexCells = !g_showConvexCells;
-                break;
-            case GLFW_KEY_S:
-                g_showSurfaceMeshes = !g_showSurfaceMeshes;
-                break;
-            case GLFW_KEY_ESCAPE:
-                glfwSetWindowShouldClose(window, GLFW_TRUE);
-                break;
-        }
+    g_needsRedraw = true;
+    if (action != GLFW_PRESS) return;
+
+    // Successive presses step from the most recent request, not the displayed file
+    size_t baseFile = g_requestedFile >= 0 ? static_cast<size_t>(g_requestedFile) : g_targetFile;
+    switch (key) {
+        case GLFW_KEY_C:
+            g_showConvexCells = !g_showConvexCells;
+            break;
+        case GLFW_KEY_S:
+            g_showSurfaceMeshes = !g_showSurfaceMeshes;
+            break;
+        case GLFW_KEY_P:
+            g_showPerformanceHud = !g_showPerformanceHud;
+            break;
+        case GLFW_KEY_R:
+            g_continuousRendering = !g_continuousRendering;
+            break;
+        case GLFW_KEY_H:
+            g_highlightedCell++;
+            if (g_highlightedCell >= static_cast<int>(g_cellCount)) {
+                g_highlightedCell = -1;
+            }
+            break;
+        case GLFW_KEY_RIGHT:
+            requestFile((baseFile + 1) % g_fileCount);
+            break;
+        case GLFW_KEY_LEFT:
+            requestFile((baseFile + g_fileCount - 1) % g_fileCount);
+            break;
+        case GLFW_KEY_ESCAPE:
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+            break;
+        default:
+            if (key >= GLFW_KEY_1 && key <= GLFW_KEY_9) {
+                requestFile(key - GLFW_KEY_1);
+            }
+            break;
     }
 }
 
-int main() {
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    g_needsRedraw = true;
+}
+
+void window_refresh_callback(GLFWwindow* window) {
+    g_needsRedraw = true;
+}
+
+int main(int argc, char** argv) {
+    // "--trace out.json" or SURFACE_TRACE=out.json records a Chrome trace until exit
+    TraceSession traceSession(parseTraceArguments(argc, argv));
+
     try {
+        // Headless batch mode never touches GLFW or GLUT
+        BatchOptions batchOptions;
+        if (parseBatchArguments(argc, argv, batchOptions)) {
+            return runBatch(batchOptions);
+        }
+
+        // Synthetic contour files for scaling studies
+        GeneratorOptions generatorOptions;
+        if (parseGeneratorArguments(argc, argv, generatorOptions)) {
+            return runGenerator(generatorOptions);
+        }
+
+        // Offscreen benchmark renders through EGL without a window
+        OffscreenOptions offscreenOptions;
+        if (parseOffscreenArguments(argc, argv, offscreenOptions)) {
+            return runOffscreen(offscreenOptions);
+        }
+
         // Initialize filesystem with debug output
         FileSystem fs("../data");
         if (fs.getFileCount() == 0) {
@@ -88,31 +156,27 @@ int main() {
         std::cout << "Found " << fs.getFileCount() << " contour files" << std::endl;
 
         // Initialize GLUT for text rendering
-        int argc = 1;
-        char *argv[] = {(char*)"Contour Viewer"};
         glutInit(&argc, argv);
 
         // Load initial contours with validation
-        std::vector<ContourPlane> contourPlanes = fs.getCurrentContours();
-        if (contourPlanes.empty()) {
+        if (fs.getCurrentContours().empty()) {
             throw std::runtime_error("Failed to load initial contours");
         }
-        std::cout << "Loaded initial file: " << fs.getCurrentFileName()
-                  << " with " << contourPlanes.size() << " planes" << std::endl;
-
-        // Initialize partitioner with validation
-        SpacePartitioner* partitioner = nullptr;
-        Projection* projection = nullptr;
+        g_fileCount = fs.getFileCount();
+        g_targetFile = fs.getCurrentIndex();
 
+        // Shared by the initial load and every background load; loads never overlap
+        PipelineContext pipeline;
+        std::unique_ptr<LoadedScene> scene;
         try {
-            partitioner = new SpacePartitioner(contourPlanes);
-            partitioner->partition();
-            projection = new Projection(*partitioner);
+            scene = buildScene(pipeline, fs.getCurrentIndex(), fs.getCurrentContours(), fs.getLastParseMs());
         }
         catch (const std::exception& e) {
             std::cerr << "Partitioner initialization error: " << e.what() << std::endl;
             throw;
         }
+        std::cout << "Loaded initial file: " << fs.getCurrentFileName()
+                  << " with " << scene->contourPlanes.size() << " planes" << std::endl;
 
         if (!glfwInit()) {
             throw std::runtime_error("Failed to initialize GLFW");
@@ -127,8 +191,6 @@ int main() {
         glfwMakeContextCurrent(window);
         glewExperimental = GL_TRUE;
         if (glewInit() != GLEW_OK) {
-            delete partitioner;
-            delete projection;
             glfwDestroyWindow(window);
             glfwTerminate();
             throw std::runtime_error("Failed to initialize GLEW");
@@ -138,111 +200,235 @@ int main() {
         glEnable(GL_DEPTH_TEST);
         glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
+        // Upload the initial scene once; it is re-uploaded only on file switches
+        SceneRenderer* renderer = new SceneRenderer();
+        renderer->upload(scene->contourPlanes, *scene->partitioner, *scene->projection);
+
+        TextRenderer* text = new TextRenderer();
+        text->init();
+        PerformanceHud hud;
+        hud.setLoadTimings(scene->timings);
+        hud.setLoadMemory(scene->memory);
+        hud.setCellCount(scene->partitioner->getConvexCells().size());
+        g_cellCount = renderer->getCellCount();
+        int shownHighlight = -1;
+
         // Set callbacks
         glfwSetKeyCallback(window, key_callback);
         glfwSetCursorPosCallback(window, mouse_callback);
         glfwSetMouseButtonCallback(window, mouse_button_callback);
         glfwSetScrollCallback(window, scroll_callback);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetWindowRefreshCallback(window, window_refresh_callback);
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
-        double lastKeyPressTime = 0.0;
-        const double keyPressDelay = 0.5;
+        CellStream cellStream;        // Finished cells of the load in flight; outlives the loader
+        CancellationToken loadCancel; // Set when a newer file is requested mid-load
+        std::mutex progressMutex;     // Guards loadProgress, written from loader and pool threads
+        std::string loadProgress;
+        std::string shownProgress;
+        std::future<std::unique_ptr<LoadedScene>> pendingLoad;
+        bool showingStream = false;   // Renderer holds a partial scene
 
         while (!glfwWindowShouldClose(window)) {
-            double currentTime = glfwGetTime();
+            // A newer request makes the load in flight pointless
+            if (g_requestedFile >= 0 && pendingLoad.valid()) {
+                loadCancel.cancel();
+            }
 
-            // Handle file switching with delay and validation
-            if (currentTime - lastKeyPressTime > keyPressDelay) {
-                bool fileChanged = false;
-                size_t oldIndex = fs.getCurrentIndex();
+            // Start loading the latest requested file once the previous load is done
+            if (g_requestedFile >= 0 && !pendingLoad.valid()) {
+                size_t index = static_cast<size_t>(g_requestedFile);
+                g_requestedFile = -1;
+                if (index != g_targetFile) {
+                    g_targetFile = index;
+                    std::string filename = fs.getFileName(index);
+                    loadCancel.reset();
+                    RunHooks hooks;
+                    hooks.stream = &cellStream;
+                    hooks.cancel = &loadCancel;
+                    hooks.progress = [&progressMutex, &loadProgress, filename](const RunProgress& progress) {
+                        std::lock_guard<std::mutex> lock(progressMutex);
+                        loadProgress = "Contour Viewer - " + filename + ": " + progress.stage + " " +
+                                       std::to_string(progress.done) + "/" + std::to_string(progress.total);
+                    };
+                    pendingLoad = std::async(std::launch::async, [&fs, &pipeline, hooks, index, filename]() {
+                        struct WakeOnExit {
+                            ~WakeOnExit() { glfwPostEmptyEvent(); }
+                        } wake;
+                        setTraceThreadName("scene loader");
+                        resetMemoryPeaks();
+                        auto start = std::chrono::steady_clock::now();
+                        std::vector<ContourPlane> contours = fs.loadContourFile(filename);
+                        return buildScene(pipeline, index, std::move(contours), elapsedMs(start), hooks);
+                    });
+                }
+            }
 
-                try {
-                    // File switching logic
-                    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS) {
-                        fs.nextFile();
-                        fileChanged = (oldIndex != fs.getCurrentIndex());
+            // Show cells and progress of the load in flight as they come in
+            if (pendingLoad.valid()) {
+                {
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    if (loadProgress != shownProgress) {
+                        glfwSetWindowTitle(window, loadProgress.c_str());
+                        shownProgress = loadProgress;
                     }
-                    else if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS) {
-                        fs.previousFile();
-                        fileChanged = (oldIndex != fs.getCurrentIndex());
+                }
+                CellStreamBatch streamed = cellStream.drain();
+                if (streamed.started) {
+                    renderer->beginStream(streamed.contourPlanes);
+                    showingStream = true;
+                    g_highlightedCell = -1;
+                    shownHighlight = -1;
+                    g_needsRedraw = true;
+                }
+                if (showingStream && !streamed.cells.empty()) {
+                    renderer->appendCells(streamed.cells);
+                    g_cellCount = renderer->getCellCount();
+                    g_needsRedraw = true;
+                }
+            }
+
+            // Swap in a finished background load; the full upload replaces the
+            // streamed cells with the final scene in cell order
+            if (pendingLoad.valid() &&
+                pendingLoad.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                try {
+                    std::unique_ptr<LoadedScene> loaded = pendingLoad.get();
+                    scene = std::move(loaded);
+                    renderer->upload(scene->contourPlanes, *scene->partitioner, *scene->projection);
+                    hud.setLoadTimings(scene->timings);
+                    hud.setLoadMemory(scene->memory);
+                    hud.setCellCount(scene->partitioner->getConvexCells().size());
+                    g_cellCount = renderer->getCellCount();
+                    g_highlightedCell = -1;
+                    shownHighlight = -1;
+
+                    std::cout << "Switched to: " << fs.getFileName(scene->fileIndex)
+                              << " (File " << scene->fileIndex + 1
+                              << "/" << fs.getFileCount() << ")" << std::endl;
+                }
+                catch (const std::exception& e) {
+                    // A cancelled load was superseded by a newer request, which starts next
+                    if (!dynamic_cast<const RunCancelled*>(&e)) {
+                        std::cerr << "File switching error: " << e.what() << std::endl;
                     }
-                    else {
-                        for (int i = 0; i < 9 && i < fs.getFileCount(); i++) {
-                            if (glfwGetKey(window, GLFW_KEY_1 + i) == GLFW_PRESS) {
-                                fileChanged = fs.selectFile(i);
-                                break;
-                            }
-                        }
+                    g_targetFile = scene->fileIndex;
+                    if (showingStream) {
+                        renderer->upload(scene->contourPlanes, *scene->partitioner, *scene->projection);
+                        g_cellCount = renderer->getCellCount();
+                        g_highlightedCell = -1;
+                        shownHighlight = -1;
                     }
+                }
+                showingStream = false;
+                {
+                    std::lock_guard<std::mutex> lock(progressMutex);
+                    loadProgress.clear();
+                    shownProgress.clear();
+                }
+                glfwSetWindowTitle(window, "Contour Viewer");
+                g_needsRedraw = true;
+                continue;
+            }
 
-                    if (fileChanged) {
-                        std::vector<ContourPlane> newContours = fs.getCurrentContours();
-                        if (!newContours.empty()) {
-                            contourPlanes = std::move(newContours);
-                            delete partitioner;
-                            partitioner = new SpacePartitioner(contourPlanes);
-                            partitioner->partition();
-
-                            delete projection;
-                            projection = new Projection(*partitioner);
-
-                            lastKeyPressTime = currentTime;
+            // A held zoom key steps once per frame, not at the OS key-repeat rate
+            bool zoomKeyHeld = process_keyboard(window);
+            if (zoomKeyHeld) {
+                g_needsRedraw = true;
+            }
+            if (cameraChanged) {
+                cameraChanged = false;
+                g_needsRedraw = true;
+            }
 
-                            std::cout << "Switched to: " << fs.getCurrentFileName()
-                                    << " (File " << fs.getCurrentIndex() + 1
-                                    << "/" << fs.getFileCount() << ")" << std::endl;
-                        }
-                    }
+            // Only the changed cells' colour ranges are rewritten
+            if (g_highlightedCell != shownHighlight) {
+                if (shownHighlight >= 0) {
+                    renderer->setCellHighlighted(shownHighlight, false);
                 }
-                catch (const std::exception& e) {
-                    std::cerr << "File switching error: " << e.what() << std::endl;
+                if (g_highlightedCell >= 0) {
+                    renderer->setCellHighlighted(g_highlightedCell, true);
                 }
+                shownHighlight = g_highlightedCell;
             }
 
-            // Update viewport and camera
-            int width, height;
-            glfwGetFramebufferSize(window, &width, &height);
-            glViewport(0, 0, width, height);
-            setupProjection(width, height);
+            if (g_needsRedraw || g_continuousRendering) {
+                g_needsRedraw = false;
+                TRACE_SCOPE("frame");
+                auto frameStart = std::chrono::steady_clock::now();
+
+                // Update viewport and camera
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                glViewport(0, 0, width, height);
+                setupProjection(width, height);
+                updateCamera();
+
+                // Render with validation
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                renderer->beginFrame();
 
-            process_keyboard(window);
-            updateCamera();
+                try {
+                    if (!scene->contourPlanes.empty()) {
+                        // Always render contour planes
+                        renderer->renderContours();
 
-            // Render with validation
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        // Cells and surfaces outside the view frustum are culled
+                        Frustum frustum = Frustum::fromMatrix(
+                            glm::value_ptr(getViewProjectionMatrix()));
 
-            try {
-                if (!contourPlanes.empty()) {
-                    // Always render contour planes
-                    renderContourPlanes(contourPlanes);
+                        // Render convex cells if enabled
+                        if (g_showConvexCells) {
+                            renderer->renderConvexCells(frustum);
+                        }
 
-                    // Render convex cells if enabled
-                    if (g_showConvexCells && partitioner->getConvexCells().size() > 0) {
-                        for (const auto& cell : partitioner->getConvexCells()) {
-                            partitioner->renderPolyhedron(cell);
+                        // Render surface meshes if enabled
+                        if (g_showSurfaceMeshes) {
+                            renderer->renderSurfaces(frustum);
                         }
-                    }
 
-                    // Render surface meshes if enabled
-                    if (g_showSurfaceMeshes) {
-                        projection->renderAllReconstructions();
+                        // Render help overlay and HUD in one text batch
+                        renderHelpOverlay(*text);
+                        if (g_showPerformanceHud) {
+                            RenderStats stats = renderer->getStats();
+                            stats.drawCalls += 1;  // The text batch itself
+                            hud.draw(*text, stats, 20.0f, 260.0f);
+                        }
+                        text->flush(width, height);
                     }
+                }
+                catch (const std::exception& e) {
+                    std::cerr << "Render error: " << e.what() << std::endl;
+                }
 
-                    // Render help overlay
-                    renderHelpOverlay();
+                {
+                    TRACE_SCOPE("swapBuffers");
+                    glfwSwapBuffers(window);
                 }
-            }
-            catch (const std::exception& e) {
-                std::cerr << "Render error: " << e.what() << std::endl;
+                hud.recordFrame(elapsedMs(frameStart));
             }
 
-            glfwSwapBuffers(window);
-            glfwPollEvents();
+            // Sleep until input, a resize or a finished load wakes us up. The loader
+            // posts an empty event just before its result becomes ready, so keep
+            // a short timeout while one is in flight. A held zoom key keeps frames
+            // coming until it is released.
+            if (g_continuousRendering || zoomKeyHeld) {
+                glfwPollEvents();
+            } else if (pendingLoad.valid()) {
+                glfwWaitEventsTimeout(0.05);
+            } else {
+                glfwWaitEvents();
+            }
         }
 
         // Cleanup
-        delete partitioner;
-        delete projection;
+        if (pendingLoad.valid()) {
+            loadCancel.cancel();
+            pendingLoad.wait();
+        }
+        delete text;
+        delete renderer;
         glfwDestroyWindow(window);
         glfwTerminate();
         return 0;
@@ -252,4 +438,4 @@ int main() {
         glfwTerminate();
         return -1;
     }
-}
\ No newline at end of file
+}
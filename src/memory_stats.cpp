@@ -0,0 +1,159 @@
+// memory_stats.cpp
+#include "memory_stats.h"
+#include <gmp.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Prefixed to every tracked block; keeps the user pointer max-aligned
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+    size_t size;
+    uint32_t stage;
+};
+
+struct StageCounters {
+    std::atomic<int64_t> live{0};
+    std::atomic<int64_t> peak{0};
+};
+
+// Plain arrays of atomics are constant-initialized, so counting works for
+// allocations made before any dynamic initializer runs
+StageCounters g_stages[MEMORY_STAGE_COUNT];
+StageCounters g_total;
+
+thread_local MemoryStage t_stage = MemoryStage::Other;
+
+void raisePeak(std::atomic<int64_t>& peak, int64_t value) {
+    int64_t current = peak.load(std::memory_order_relaxed);
+    while (value > current &&
+           !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void addBytes(uint32_t stage, int64_t bytes) {
+    StageCounters& counters = g_stages[stage];
+    int64_t live = counters.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t total = g_total.live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    if (bytes > 0) {
+        raisePeak(counters.peak, live);
+        raisePeak(g_total.peak, total);
+    }
+}
+
+void* trackedAlloc(size_t size) {
+    void* raw = std::malloc(sizeof(BlockHeader) + size);
+    if (!raw) return nullptr;
+    BlockHeader* header = static_cast<BlockHeader*>(raw);
+    header->size = size;
+    header->stage = static_cast<uint32_t>(t_stage);
+    addBytes(header->stage, static_cast<int64_t>(size));
+    return header + 1;
+}
+
+void trackedFree(void* ptr) {
+    if (!ptr) return;
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    addBytes(header->stage, -static_cast<int64_t>(header->size));
+    std::free(header);
+}
+
+void* trackedRealloc(void* ptr, size_t size) {
+    if (!ptr) return trackedAlloc(size);
+    BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+    size_t oldSize = header->size;
+    uint32_t stage = header->stage;
+    BlockHeader* moved = static_cast<BlockHeader*>(std::realloc(header, sizeof(BlockHeader) + size));
+    if (!moved) return nullptr;
+    moved->size = size;
+    addBytes(stage, static_cast<int64_t>(size) - static_cast<int64_t>(oldSize));
+    return moved + 1;
+}
+
+void* allocOrThrow(size_t size) {
+    void* ptr = trackedAlloc(size == 0 ? 1 : size);
+    while (!ptr) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+        ptr = trackedAlloc(size == 0 ? 1 : size);
+    }
+    return ptr;
+}
+
+void* gmpAlloc(size_t size) {
+    void* ptr = trackedAlloc(size);
+    if (!ptr) std::abort();  // GMP has no way to report allocation failure
+    return ptr;
+}
+
+void* gmpRealloc(void* ptr, size_t, size_t newSize) {
+    void* moved = trackedRealloc(ptr, newSize);
+    if (!moved) std::abort();
+    return moved;
+}
+
+void gmpFree(void* ptr, size_t) {
+    trackedFree(ptr);
+}
+
+// GMP blocks must all come from the tracked allocator, so the hooks are
+// installed before any other static initializer can create an mpq_t
+struct GmpAllocatorInstaller {
+    GmpAllocatorInstaller() { mp_set_memory_functions(gmpAlloc, gmpRealloc, gmpFree); }
+};
+#if defined(__GNUC__)
+__attribute__((init_priority(101)))
+#endif
+GmpAllocatorInstaller g_gmpAllocatorInstaller;
+
+} // namespace
+
+void* operator new(size_t size) { return allocOrThrow(size); }
+void* operator new[](size_t size) { return allocOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size == 0 ? 1 : size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size == 0 ? 1 : size); }
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+
+const char* memoryStageName(MemoryStage stage) {
+    switch (stage) {
+        case MemoryStage::Parse: return "parse";
+        case MemoryStage::Partition: return "partition";
+        case MemoryStage::Filter: return "filter";
+        case MemoryStage::Projection: return "projection";
+        case MemoryStage::Triangulation: return "triangulation";
+        default: return "other";
+    }
+}
+
+MemoryReport getMemoryReport() {
+    MemoryReport report;
+    for (size_t i = 0; i < MEMORY_STAGE_COUNT; i++) {
+        report.liveBytes[i] = g_stages[i].live.load(std::memory_order_relaxed);
+        report.peakBytes[i] = g_stages[i].peak.load(std::memory_order_relaxed);
+    }
+    report.totalLiveBytes = g_total.live.load(std::memory_order_relaxed);
+    report.totalPeakBytes = g_total.peak.load(std::memory_order_relaxed);
+    return report;
+}
+
+void resetMemoryPeaks() {
+    for (auto& counters : g_stages) {
+        counters.peak.store(counters.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    g_total.peak.store(g_total.live.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+MemoryStageScope::MemoryStageScope(MemoryStage stage) : m_previous(t_stage) {
+    t_stage = stage;
+}
+
+MemoryStageScope::~MemoryStageScope() {
+    t_stage = m_previous;
+}
@@ -0,0 +1,299 @@
+// offscreen.cpp
+#include "offscreen.h"
+#include <GL/glew.h>
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <png.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <filesystem>
+#include "camera.h"
+#include "pipeline.h"
+#include "render.h"
+#include "timing.h"
+#include "trace.h"
+namespace fs = std::filesystem;
+
+namespace {
+
+// Surfaceless EGL context with an FBO standing in for the window
+class OffscreenContext {
+public:
+    OffscreenContext(int width, int height) : m_width(width), m_height(height) {
+        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            m_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (m_display == EGL_NO_DISPLAY) {
+            m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (m_display == EGL_NO_DISPLAY || !eglInitialize(m_display, nullptr, nullptr)) {
+            throw std::runtime_error("Failed to initialize EGL display");
+        }
+
+        const EGLint configAttribs[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        if (!eglBindAPI(EGL_OPENGL_API) ||
+            !eglChooseConfig(m_display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+            eglTerminate(m_display);
+            throw std::runtime_error("No EGL config with desktop OpenGL support");
+        }
+
+        m_context = eglCreateContext(m_display, config, EGL_NO_CONTEXT, nullptr);
+        if (m_context == EGL_NO_CONTEXT ||
+            !eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_context)) {
+            eglTerminate(m_display);
+            throw std::runtime_error("Failed to create surfaceless EGL context");
+        }
+
+        glewExperimental = GL_TRUE;
+        GLenum glewStatus = glewInit();
+        // GLEW built for GLX reports a missing display here even though GL loaded fine
+        if (glewStatus != GLEW_OK && !glGenFramebuffers) {
+            throw std::runtime_error("Failed to initialize GLEW");
+        }
+
+        glGenFramebuffers(1, &m_fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        glGenRenderbuffers(2, m_renderbuffers);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[0]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffers[0]);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_renderbuffers[1]);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_renderbuffers[1]);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            throw std::runtime_error("Offscreen framebuffer is incomplete");
+        }
+
+        std::cout << "Offscreen renderer: " << glGetString(GL_RENDERER) << std::endl;
+    }
+
+    ~OffscreenContext() {
+        if (m_fbo) {
+            glDeleteRenderbuffers(2, m_renderbuffers);
+            glDeleteFramebuffers(1, &m_fbo);
+        }
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(m_display, m_context);
+        eglTerminate(m_display);
+    }
+
+    // Bottom-up RGBA rows flipped into top-down image order
+    std::vector<unsigned char> readPixels() const {
+        std::vector<unsigned char> pixels(static_cast<size_t>(m_width) * m_height * 4);
+        std::vector<unsigned char> flipped(pixels.size());
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+        size_t rowBytes = static_cast<size_t>(m_width) * 4;
+        for (int y = 0; y < m_height; y++) {
+            std::copy_n(pixels.begin() + (m_height - 1 - y) * rowBytes, rowBytes,
+                        flipped.begin() + y * rowBytes);
+        }
+        return flipped;
+    }
+
+private:
+    int m_width;
+    int m_height;
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLContext m_context = EGL_NO_CONTEXT;
+    GLuint m_fbo = 0;
+    GLuint m_renderbuffers[2] = {0, 0};
+};
+
+bool writePng(const std::string& path, const std::vector<unsigned char>& rgba, int width, int height) {
+    png_image image = {};
+    image.version = PNG_IMAGE_VERSION;
+    image.width = width;
+    image.height = height;
+    image.format = PNG_FORMAT_RGBA;
+    return png_image_write_to_file(&image, path.c_str(), 0, rgba.data(), 0, nullptr) != 0;
+}
+
+bool readPng(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height) {
+    png_image image = {};
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, path.c_str())) {
+        return false;
+    }
+    image.format = PNG_FORMAT_RGBA;
+    rgba.resize(PNG_IMAGE_SIZE(image));
+    width = image.width;
+    height = image.height;
+    return png_image_finish_read(&image, nullptr, rgba.data(), 0, nullptr) != 0;
+}
+
+// Fraction of pixels where any channel differs by more than a small threshold
+double compareImages(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b) {
+    const int channelThreshold = 8;
+    size_t differing = 0;
+    size_t pixelCount = a.size() / 4;
+    for (size_t i = 0; i < pixelCount; i++) {
+        for (int c = 0; c < 4; c++) {
+            if (std::abs(int(a[i * 4 + c]) - int(b[i * 4 + c])) > channelThreshold) {
+                differing++;
+                break;
+            }
+        }
+    }
+    return pixelCount > 0 ? double(differing) / pixelCount : 0.0;
+}
+
+std::string frameFileName(int frame) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "frame_%04d.png", frame);
+    return name;
+}
+
+} // namespace
+
+bool parseOffscreenArguments(int argc, char** argv, OffscreenOptions& options) {
+    if (argc < 3 || std::string(argv[1]) != "--offscreen") {
+        return false;
+    }
+
+    options.inputFile = argv[2];
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--frames" && i + 1 < argc) {
+            options.frames = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--size" && i + 1 < argc) {
+            if (std::sscanf(argv[++i], "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                throw std::runtime_error("Invalid --size, expected WxH");
+            }
+        }
+        else if (arg == "--dump" && i + 1 < argc) {
+            options.dumpDir = argv[++i];
+        }
+        else if (arg == "--golden" && i + 1 < argc) {
+            options.goldenDir = argv[++i];
+        }
+        else if (arg == "--tolerance" && i + 1 < argc) {
+            options.tolerance = std::stod(argv[++i]);
+        }
+        else if (arg == "--simplify" && i + 1 < argc) {
+            options.simplifyTolerance = std::max(0.0, std::stod(argv[++i]));
+        }
+        else if (arg == "--facets" && i + 1 < argc) {
+            options.facets = argv[++i];
+            parseFacetExtraction(options.facets);
+        }
+        else {
+            throw std::runtime_error("Unknown offscreen argument: " + arg);
+        }
+    }
+
+    return true;
+}
+
+int runOffscreen(const OffscreenOptions& options) {
+    PipelineOptions pipelineOptions;
+    pipelineOptions.simplifyTolerance = options.simplifyTolerance;
+    pipelineOptions.facetExtraction = parseFacetExtraction(options.facets);
+    PipelineContext pipeline(pipelineOptions);
+    PipelineResult scene = pipeline.run(options.inputFile);
+    std::cout << "Pipeline peak heap " << toMegabytes(scene.memory.totalPeakBytes) << " MB"
+              << " (partition " << toMegabytes(scene.memory.peak(MemoryStage::Partition))
+              << ", filter " << toMegabytes(scene.memory.peak(MemoryStage::Filter))
+              << ", triangulation " << toMegabytes(scene.memory.peak(MemoryStage::Triangulation))
+              << " MB)" << std::endl;
+
+    OffscreenContext context(options.width, options.height);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+    SceneRenderer renderer;
+    renderer.upload(scene.contourPlanes, *scene.partitioner, *scene.projection);
+
+    if (!options.dumpDir.empty()) {
+        fs::create_directories(options.dumpDir);
+    }
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(options.frames);
+    size_t failedFrames = 0;
+
+    for (int frame = 0; frame < options.frames; frame++) {
+        cameraYaw = 360.0f * frame / options.frames;
+        cameraPitch = 20.0f;
+
+        TRACE_SCOPE_ARG("frame", "index", frame);
+        auto start = std::chrono::steady_clock::now();
+        glViewport(0, 0, options.width, options.height);
+        setupProjection(options.width, options.height);
+        updateCamera();
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        renderer.beginFrame();
+        Frustum frustum = Frustum::fromMatrix(glm::value_ptr(getViewProjectionMatrix()));
+        renderer.renderContours();
+        renderer.renderConvexCells(frustum);
+        renderer.renderSurfaces(frustum);
+        {
+            TRACE_SCOPE("glFinish");
+            glFinish();
+        }
+        frameTimes.push_back(elapsedMs(start));
+
+        if (options.dumpDir.empty() && options.goldenDir.empty()) continue;
+
+        std::vector<unsigned char> pixels = context.readPixels();
+        std::string name = frameFileName(frame);
+
+        if (!options.dumpDir.empty() &&
+            !writePng(options.dumpDir + "/" + name, pixels, options.width, options.height)) {
+            std::cerr << "Could not write " << options.dumpDir + "/" + name << std::endl;
+        }
+
+        if (!options.goldenDir.empty()) {
+            std::vector<unsigned char> golden;
+            int goldenWidth = 0, goldenHeight = 0;
+            std::string goldenPath = options.goldenDir + "/" + name;
+            if (!readPng(goldenPath, golden, goldenWidth, goldenHeight) ||
+                goldenWidth != options.width || goldenHeight != options.height) {
+                std::cerr << "Missing or mismatched golden image " << goldenPath << std::endl;
+                failedFrames++;
+                continue;
+            }
+
+            double difference = compareImages(pixels, golden);
+            if (difference > options.tolerance) {
+                std::cerr << name << " differs from golden in "
+                          << difference * 100.0 << "% of pixels" << std::endl;
+                failedFrames++;
+            }
+        }
+    }
+
+    std::vector<double> sorted = frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double t : frameTimes) total += t;
+
+    std::cout << "Rendered " << frameTimes.size() << " frames at "
+              << options.width << "x" << options.height << std::endl;
+    std::cout << "  mean " << total / frameTimes.size() << " ms/frame"
+              << ", p50 " << sorted[sorted.size() / 2] << " ms"
+              << ", p95 " << sorted[(sorted.size() - 1) * 95 / 100] << " ms" << std::endl;
+
+    if (!options.goldenDir.empty()) {
+        std::cout << failedFrames << " of " << frameTimes.size()
+                  << " frames differ from golden images" << std::endl;
+    }
+    return failedFrames == 0 ? 0 : 1;
+}
@@ -1,16 +1,46 @@
 // partition.cpp
 #include "partition.h"
+#include "memory_stats.h"
+#include "timing.h"
+#include "trace.h"
 #include <CGAL/bounding_box.h>
 #include <CGAL/convex_hull_3.h>
 #include <CGAL/Cartesian_converter.h>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
 #include <iostream>
 #include <CGAL/IO/Polyhedron_OFF_iostream.h>
+#include <CGAL/IO/Nef_polyhedron_iostream_3.h>
 #include <filesystem>
+#include <functional>
+#include <thread>
+#include <unistd.h>
 namespace fs = std::filesystem;
 
+namespace {
+
+// Bumped whenever cached cells change meaning, so older entries are never read.
+// 2: .planes lists every contour plane the cell lies on the positive side of
+// 3: coplanar contours facing the other way are recorded on their own side
+const int CELL_CACHE_VERSION = 3;
+
+// Names private directories apart across threads and processes sharing a cache
+std::string writerSuffix() {
+    return std::to_string(getpid()) + "-" +
+           std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+}
+
+} // namespace
+
 std::string SpacePartitioner::getConvexCellsPath(const std::string& contourName) const {
-    return "../data/convex_cells/" + contourName;
+    return m_cacheDir + "/" + contourName + "_v" + std::to_string(CELL_CACHE_VERSION);
 }
 
 void SpacePartitioner::ensureDirectoryExists(const std::string& path) const {
@@ -18,12 +48,22 @@ void SpacePartitioner::ensureDirectoryExists(const std::string& path) const {
 }
 
 bool SpacePartitioner::loadConvexCells(const std::string& contourName) {
+    TRACE_SCOPE("loadConvexCells");
     std::string cellsDir = getConvexCellsPath(contourName);
     if (!fs::exists(cellsDir)) return false;
 
     m_cells.clear();
     size_t cellCount = 0;
 
+    // An unreadable entry would block the fresh one from being renamed into place
+    auto discard = [&](const std::string& reason) {
+        std::cerr << "Discarding cell cache " << cellsDir << ": " << reason << std::endl;
+        m_cells.clear();
+        std::error_code ignored;
+        fs::remove_all(cellsDir, ignored);
+        return false;
+    };
+
     for (const auto& entry : fs::directory_iterator(cellsDir)) {
         if (entry.path().extension() == ".off") {
             ConvexCell cell;
@@ -31,64 +71,191 @@ bool SpacePartitioner::loadConvexCells(const std::string& contourName) {
             // Load geometry
             std::ifstream geomFile(entry.path());
             if (!geomFile || !CGAL::read_off(geomFile, cell.geometry)) {
-                return false;
+                return discard("could not read " + entry.path().string());
             }
 
             // Load plane associations
             std::string planesPath = entry.path().string();
             planesPath.replace(planesPath.end()-4, planesPath.end(), ".planes");
             std::ifstream planesFile(planesPath);
+            if (!planesFile) {
+                return discard("missing " + planesPath);
+            }
             size_t planeIdx;
             while (planesFile >> planeIdx) {
                 cell.planeIndices.push_back(planeIdx);
             }
+            if (!planesFile.eof()) {
+                return discard("could not read " + planesPath);
+            }
 
             m_cells.push_back(cell);
             cellCount++;
         }
     }
 
-    return cellCount > 0;
+    if (cellCount == 0) {
+        return discard("no cells");
+    }
+
+    buildCellMeshes();
+    return true;
 }
 
-void SpacePartitioner::saveConvexCells(const std::string& contourName) const {
-    if (m_cells.empty()) return;
+class SpacePartitioner::CacheWriter {
+public:
+    // Written to a private directory and renamed into place, so readers and
+    // concurrent writers never see a partial cache entry
+    explicit CacheWriter(const std::string& cellsDir)
+        : m_cellsDir(cellsDir),
+          m_partialDir(cellsDir + ".partial-" + writerSuffix()) {
+        std::error_code ignored;
+        fs::remove_all(m_partialDir, ignored);
+        fs::create_directories(m_partialDir);
+    }
 
-    std::string cellsDir = getConvexCellsPath(contourName);
-    ensureDirectoryExists(cellsDir);
+    ~CacheWriter() {
+        std::error_code ignored;
+        fs::remove_all(m_partialDir, ignored);
+    }
+
+    CacheWriter(const CacheWriter&) = delete;
+    CacheWriter& operator=(const CacheWriter&) = delete;
+
+    void write(const ConvexCell& cell) {
+        if (!m_written) return;
+        std::string base = m_partialDir + "/cell_" + std::to_string(m_count++);
 
-    for (size_t i = 0; i < m_cells.size(); ++i) {
         // Save geometry
-        std::string offFile = cellsDir + "/cell_" + std::to_string(i) + ".off";
-        std::ofstream geomFile(offFile);
-        if (geomFile) {
-            CGAL::write_off(geomFile, m_cells[i].geometry);
-        }
+        std::ofstream geomFile(base + ".off");
+        m_written = geomFile && CGAL::write_off(geomFile, cell.geometry);
 
         // Save plane associations
-        std::string planesFile = cellsDir + "/cell_" + std::to_string(i) + ".planes";
-        std::ofstream planeFile(planesFile);
-        if (planeFile) {
-            for (size_t idx : m_cells[i].planeIndices) {
-                planeFile << idx << " ";
-            }
+        std::ofstream planeFile(base + ".planes");
+        for (size_t idx : cell.planeIndices) {
+            planeFile << idx << " ";
         }
+        m_written = m_written && planeFile.good();
     }
+
+    // A bad entry already in place was removed by loadConvexCells, so one found
+    // here was published by a concurrent writer from the same contours and is kept
+    void commit() {
+        if (!m_written) {
+            std::cerr << "Could not write cell cache " << m_partialDir << std::endl;
+            return;
+        }
+        if (m_count == 0) return;
+
+        std::error_code error;
+        fs::rename(m_partialDir, m_cellsDir, error);
+        if (error) {
+            std::cerr << "Could not publish cell cache " << m_cellsDir << ": "
+                      << (fs::exists(m_cellsDir) ? "another writer published it first" : error.message())
+                      << std::endl;
+        }
+    }
+
+private:
+    std::string m_cellsDir;
+    std::string m_partialDir;
+    size_t m_count = 0;
+    bool m_written = true;
+};
+
+void SpacePartitioner::saveConvexCells(const std::string& contourName) const {
+    TRACE_SCOPE("saveConvexCells");
+    if (m_cells.empty()) return;
+
+    CacheWriter cache(getConvexCellsPath(contourName));
+    for (const auto& cell : m_cells) {
+        cache.write(cell);
+    }
+    cache.commit();
 }
 
 // Converter between kernels
 typedef CGAL::Cartesian_converter<InexactKernel, ExactKernel> IK_to_EK;
+
+namespace {
+
+// Exact test for the same supporting plane in either orientation: the
+// coefficient vectors are proportional iff every 2x2 minor vanishes
+bool sameSupportingPlane(const Plane& p, const Plane& q) {
+    const std::array<CGAL::Gmpq, 4> a = {p.a(), p.b(), p.c(), p.d()};
+    const std::array<CGAL::Gmpq, 4> b = {q.a(), q.b(), q.c(), q.d()};
+    for (int i = 0; i < 4; i++) {
+        for (int j = i + 1; j < 4; j++) {
+            if (a[i] * b[j] != a[j] * b[i]) return false;
+        }
+    }
+    return true;
+}
+
+// Unit normals within tolerance of parallel and offsets within tolerance
+bool nearlySamePlane(const Plane& p, const Plane& q, double tolerance) {
+    InexactKernel::Vector_3 np = p.orthogonal_vector(), nq = q.orthogonal_vector();
+    double lp = std::sqrt(np.squared_length()), lq = std::sqrt(nq.squared_length());
+    if (lp == 0.0 || lq == 0.0) return false;
+
+    double sign = (np * nq) < 0 ? -1.0 : 1.0;
+    InexactKernel::Vector_3 cross = CGAL::cross_product(np / lp, nq / lq);
+    double offsetDifference = std::abs(p.d() / lp - sign * q.d() / lq);
+    return std::sqrt(cross.squared_length()) <= tolerance && offsetDifference <= tolerance;
+}
+
+} // namespace
 typedef CGAL::Cartesian_converter<ExactKernel, InexactKernel> EK_to_IK;
 
 SpacePartitioner::SpacePartitioner(const std::vector<ContourPlane>& contourPlanes)
     : m_contourPlanes(contourPlanes) {}
 
+SpacePartitioner::CellMesh SpacePartitioner::buildCellMesh(const CGAL::Polyhedron_3<ExactKernel>& poly) {
+    CellMesh mesh;
+    mesh.vertices.reserve(poly.size_of_vertices());
+    mesh.edges.reserve(poly.size_of_halfedges() / 2);
+
+    std::map<const ExactPolyhedron::Vertex*, uint32_t> vertexIndices;
+    for (auto v = poly.vertices_begin(); v != poly.vertices_end(); ++v) {
+        vertexIndices[&*v] = static_cast<uint32_t>(mesh.vertices.size());
+        mesh.vertices.push_back({CGAL::to_double(v->point().x()),
+                                 CGAL::to_double(v->point().y()),
+                                 CGAL::to_double(v->point().z())});
+    }
+
+    for (auto e = poly.edges_begin(); e != poly.edges_end(); ++e) {
+        mesh.edges.emplace_back(vertexIndices[&*e->vertex()],
+                                vertexIndices[&*e->opposite()->vertex()]);
+    }
+
+    mesh.faceOffsets.push_back(0);
+    for (auto f = poly.facets_begin(); f != poly.facets_end(); ++f) {
+        auto h = f->facet_begin();
+        do {
+            mesh.faceIndices.push_back(vertexIndices[&*h->vertex()]);
+        } while (++h != f->facet_begin());
+        mesh.faceOffsets.push_back(static_cast<uint32_t>(mesh.faceIndices.size()));
+    }
+
+    for (const auto& v : mesh.vertices) {
+        mesh.bbox += CGAL::Bbox_3(v[0], v[1], v[2], v[0], v[1], v[2]);
+    }
+    return mesh;
+}
+
+void SpacePartitioner::buildCellMeshes() {
+    TRACE_SCOPE("buildCellMeshes");
+    for (auto& cell : m_cells) {
+        cell.mesh = buildCellMesh(cell.geometry);
+    }
+}
+
 std::pair<Point, Point> SpacePartitioner::getBBoxCorners() const {
     std::vector<Point> allPoints;
     for (const auto& contourPlane : m_contourPlanes) {
         allPoints.insert(allPoints.end(), 
-                        contourPlane.vertices.begin(),
-                        contourPlane.vertices.end());
+                        contourPlane.vertices().begin(),
+                        contourPlane.vertices().end());
     }
     
     auto bbox = CGAL::bounding_box(allPoints.begin(), allPoints.end());
@@ -106,8 +273,12 @@ std::pair<Point, Point> SpacePartitioner::getBBoxCorners() const {
 }
 
 Nef_polyhedron SpacePartitioner::computeBoundingBox() const {
+    TRACE_SCOPE("computeBoundingBox");
     auto [min_corner, max_corner] = getBBoxCorners();
-    
+    return makeBox(min_corner, max_corner);
+}
+
+Nef_polyhedron SpacePartitioner::makeBox(const Point& min_corner, const Point& max_corner) {
     // Convert to exact kernel
     IK_to_EK to_exact;
     
@@ -137,95 +308,470 @@ Nef_polyhedron SpacePartitioner::computeBoundingBox() const {
 }
 
 void SpacePartitioner::partition() {
-    std::string contourName = fs::path(m_contourPlanes[0].filename).stem().string();
+    TRACE_SCOPE("partition");
+    MemoryStageScope memoryStage(MemoryStage::Partition);
+    std::string contourName = fs::path(m_contourPlanes[0].filename()).stem().string() + m_cacheTag;
+    auto start = std::chrono::steady_clock::now();
+    m_filterMs = 0.0;
+
+    // Tolerant merging and block decomposition change the cells, so they get their own cache entries
+    groupCoplanarPlanes();
+    if (m_planeMergeTolerance > 0.0) {
+        // Full precision, so every distinct tolerance gets its own entry
+        std::ostringstream tag;
+        tag << "_merge" << std::setprecision(17) << m_planeMergeTolerance;
+        contourName += tag.str();
+    }
+    if (m_octreeDepth > 0) {
+        contourName += "_octree" + std::to_string(m_octreeDepth) + "x" + std::to_string(m_octreeBlockPlanes);
+    }
     
-    if (loadConvexCells(contourName)) {
+    m_loadedFromCache = loadConvexCells(contourName);
+    if (m_loadedFromCache) {
+        m_partitionMs = elapsedMs(start);
         return;
     }
 
     std::cout << "Computing partition for " << contourName << "..." << std::endl;
+    if (m_control) m_control->check();
     precomputePlanes();
-    m_partitionedSpace = computeBoundingBox();
-    
-    std::vector<std::pair<Nef_polyhedron, std::set<size_t>>> nefPolys;
-    partitionSpace(m_partitionedSpace, 0, nefPolys);
-
-    // Filter elementary cells
+    m_splitsDone = 0;
+    m_spilledPieces = 0;
     m_cells.clear();
-    for (const auto& [nef, planeSet] : nefPolys) {
+
+    // Spill files live next to the cache entry and go away however partition() ends
+    m_spillDir = getConvexCellsPath(contourName) + ".spill-" + writerSuffix();
+    struct SpillCleanup {
+        const std::string& dir;
+        ~SpillCleanup() {
+            std::error_code ignored;
+            fs::remove_all(dir, ignored);
+        }
+    } spillCleanup{m_spillDir};
+
+    // Finished cells are written as they are produced and published at the end
+    CacheWriter cache(getConvexCellsPath(contourName));
+    if (m_octreeDepth > 0) {
+        partitionBlocks(cache);
+    } else {
+        m_estimatedSplits = estimateSplitCount(m_exactPlanes.size());
+        std::vector<size_t> planes(m_exactPlanes.size());
+        std::iota(planes.begin(), planes.end(), 0);
+        NefCells candidates;
+        partitionSpace(computeBoundingBox(), planes, candidates);
+
+        auto filterStart = std::chrono::steady_clock::now();
+        for (size_t index : findElementaryCells(candidates, true)) {
+            ConvexCell cell;
+            restore(candidates[index]).convert_to_polyhedron(cell.geometry);
+            cell.planeIndices.assign(candidates[index].planes.begin(), candidates[index].planes.end());
+            cache.write(cell);
+            m_cells.push_back(std::move(cell));
+        }
+        m_filterMs = elapsedMs(filterStart);
+    }
+    if (m_spilledPieces > 0) {
+        std::cout << "Spilled " << m_spilledPieces << " pieces to disk" << std::endl;
+    }
+
+    buildCellMeshes();
+    cache.commit();
+    m_partitionMs = elapsedMs(start);
+}
+
+std::vector<size_t> SpacePartitioner::findElementaryCells(const NefCells& cells, bool reportProgress) const {
+    TRACE_SCOPE_ARG("filterElementaryCells", "candidates", cells.size());
+    MemoryStageScope filterStage(MemoryStage::Filter);
+    std::vector<size_t> elementary;
+    for (size_t candidate = 0; candidate < cells.size(); candidate++) {
+        if (m_control) {
+            m_control->check();
+            if (reportProgress) m_control->report("filter", candidate, cells.size());
+        }
         bool isElementary = true;
-        CGAL::Polyhedron_3<ExactKernel> poly_i;
-        nef.convert_to_polyhedron(poly_i);
-        
-        for (const auto& [other_nef, other_set] : nefPolys) {
-            if (&nef != &other_nef) {
-                Nef_polyhedron intersection = nef * other_nef;
-                if (!intersection.is_empty()) {
-                    CGAL::Polyhedron_3<ExactKernel> poly_intersection;
-                    intersection.convert_to_polyhedron(poly_intersection);
-                    
-                    if (poly_intersection.size_of_vertices() == poly_i.size_of_vertices()) {
-                        isElementary = false;
-                        break;
-                    }
-                }
+        Nef_polyhedron nef = peek(cells[candidate]);
+
+        // Only a candidate reaching over the whole cell can cover it
+        for (size_t other = 0; other < cells.size(); other++) {
+            if (other == candidate || !CGAL::do_overlap(cells[candidate].bbox, cells[other].bbox)) continue;
+            if (coversCell(nef, cells[candidate].vertexCount, peek(cells[other]))) {
+                isElementary = false;
+                break;
             }
         }
-        
+    
         if (isElementary) {
-            ConvexCell cell;
-            nef.convert_to_polyhedron(cell.geometry);
-            cell.planeIndices.insert(cell.planeIndices.end(), 
-                                   planeSet.begin(), planeSet.end());
-            m_cells.push_back(cell);
+            elementary.push_back(candidate);
         }
     }
+    return elementary;
+}
+
+void SpacePartitioner::buildBlocks(const Point& min_corner, const Point& max_corner,
+                                   const std::vector<size_t>& planes, size_t depth,
+                                   const std::vector<CGAL::Bbox_3>& contourBoxes,
+                                   std::vector<Block>& blocks) const {
+    if (depth == m_octreeDepth || planes.size() <= m_octreeBlockPlanes) {
+        blocks.push_back({min_corner, max_corner, planes});
+        return;
+    }
 
-    saveConvexCells(contourName);
+    // Children share the parent's midpoints exactly, so their faces coincide
+    double mid[3] = {(min_corner.x() + max_corner.x()) / 2,
+                     (min_corner.y() + max_corner.y()) / 2,
+                     (min_corner.z() + max_corner.z()) / 2};
+    for (int octant = 0; octant < 8; octant++) {
+        double lo[3], hi[3];
+        for (int axis = 0; axis < 3; axis++) {
+            bool upper = octant & (1 << axis);
+            lo[axis] = upper ? mid[axis] : min_corner[axis];
+            hi[axis] = upper ? max_corner[axis] : mid[axis];
+        }
+        CGAL::Bbox_3 box(lo[0], lo[1], lo[2], hi[0], hi[1], hi[2]);
+
+        std::vector<size_t> nearby;
+        for (size_t group : planes) {
+            if (CGAL::do_overlap(box, contourBoxes[group])) nearby.push_back(group);
+        }
+        buildBlocks(Point(lo[0], lo[1], lo[2]), Point(hi[0], hi[1], hi[2]), nearby, depth + 1,
+                    contourBoxes, blocks);
+    }
 }
 
-void SpacePartitioner::precomputePlanes() {
-    IK_to_EK to_exact;
-    m_exactPlanes.reserve(m_contourPlanes.size());
-    for (const auto& plane : m_contourPlanes) {
-        m_exactPlanes.push_back(to_exact(plane.plane));
+void SpacePartitioner::partitionBlocks(CacheWriter& cache) {
+    // Contours of each plane group, padded a little so touching blocks see them
+    auto [min_corner, max_corner] = getBBoxCorners();
+    double margin = 1e-3 * std::sqrt(CGAL::squared_distance(min_corner, max_corner));
+    std::vector<CGAL::Bbox_3> contourBoxes(m_planeGroups.size());
+    for (size_t group = 0; group < m_planeGroups.size(); group++) {
+        for (size_t member : m_planeGroups[group]) {
+            for (const Point& p : m_contourPlanes[member].vertices()) {
+                contourBoxes[group] += p.bbox();
+            }
+        }
+        const CGAL::Bbox_3& b = contourBoxes[group];
+        contourBoxes[group] = CGAL::Bbox_3(b.xmin() - margin, b.ymin() - margin, b.zmin() - margin,
+                                           b.xmax() + margin, b.ymax() + margin, b.zmax() + margin);
+    }
+
+    std::vector<size_t> allPlanes(m_exactPlanes.size());
+    std::iota(allPlanes.begin(), allPlanes.end(), 0);
+    std::vector<Block> blocks;
+    buildBlocks(min_corner, max_corner, allPlanes, 0, contourBoxes, blocks);
+
+    m_estimatedSplits = 0;
+    for (const Block& block : blocks) {
+        m_estimatedSplits += estimateSplitCount(block.planes.size());
+    }
+    std::cout << "Partitioning " << blocks.size() << " blocks in parallel" << std::endl;
+
+    // Blocks are independent: each is cut by its own planes and filtered on its own
+    std::vector<NefCells> blockCells(blocks.size());
+    std::mutex filterMutex;
+    auto task = [&](size_t index, size_t) {
+        TRACE_SCOPE_ARG("partitionBlock", "planes", blocks[index].planes.size());
+        MemoryStageScope blockStage(MemoryStage::Partition);
+        NefCells candidates;
+        partitionSpace(makeBox(blocks[index].min, blocks[index].max), blocks[index].planes, candidates);
+
+        auto filterStart = std::chrono::steady_clock::now();
+        for (size_t elementary : findElementaryCells(candidates, false)) {
+            blockCells[index].push_back(std::move(candidates[elementary]));
+        }
+        std::lock_guard<std::mutex> lock(filterMutex);
+        m_filterMs += elapsedMs(filterStart);  // Summed over blocks
+    };
+    if (m_pool) {
+        m_pool->parallelFor(blocks.size(), task);
+    } else {
+        for (size_t index = 0; index < blocks.size(); index++) {
+            task(index, 0);
+        }
+    }
+
+    std::vector<BlockCell> cells;
+    for (size_t index = 0; index < blocks.size(); index++) {
+        std::set<size_t> seen;
+        for (size_t group : blocks[index].planes) {
+            seen.insert(m_planeGroups[group].begin(), m_planeGroups[group].end());
+        }
+        for (NefCell& piece : blockCells[index]) {
+            BlockCell cell;
+            restore(piece).convert_to_polyhedron(cell.geometry);
+            cell.planes = std::move(piece.planes);
+            cell.seen = seen;
+            cells.push_back(std::move(cell));
+        }
+    }
+    stitchBlockCells(cells);
+
+    for (auto& stitched : cells) {
+        ConvexCell cell;
+        cell.geometry = std::move(stitched.geometry);
+        cell.planeIndices.assign(stitched.planes.begin(), stitched.planes.end());
+        cache.write(cell);
+        m_cells.push_back(std::move(cell));
     }
 }
 
-void SpacePartitioner::partitionSpace(
-    Nef_polyhedron& space,
-    size_t planeIndex,
-    std::vector<std::pair<Nef_polyhedron, std::set<size_t>>>& nefPolys) {
-    
-    if (space.is_empty() || space.number_of_vertices() == 0) {
-        return;
+void SpacePartitioner::stitchBlockCells(std::vector<BlockCell>& cells) const {
+    TRACE_SCOPE_ARG("stitchBlockCells", "cells", cells.size());
+    size_t before = cells.size();
+
+    std::vector<CGAL::Bbox_3> boxes;
+    for (const auto& cell : cells) {
+        CGAL::Bbox_3 box;
+        for (auto v = cell.geometry.vertices_begin(); v != cell.geometry.vertices_end(); ++v) {
+            double x = CGAL::to_double(v->point().x());
+            double y = CGAL::to_double(v->point().y());
+            double z = CGAL::to_double(v->point().z());
+            box += CGAL::Bbox_3(x, y, z, x, y, z);
+        }
+        boxes.push_back(box);
     }
-    
-    if (planeIndex >= m_exactPlanes.size()) {
-        nefPolys.push_back({space, std::set<size_t>()});
-        return;
+
+    // Two cells may be parts of one cell when they agree on the side of every
+    // plane both of their blocks split by
+    auto compatible = [&](const BlockCell& a, const BlockCell& b) {
+        for (size_t plane : a.seen) {
+            if (b.seen.count(plane) && a.planes.count(plane) != b.planes.count(plane)) return false;
+        }
+        return true;
+    };
+
+    // Merge touching pairs whose union is convex until none are left
+    std::vector<bool> alive(cells.size(), true);
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t a = 0; a < cells.size(); a++) {
+            if (!alive[a]) continue;
+            for (size_t b = a + 1; b < cells.size(); b++) {
+                if (!alive[b] || !CGAL::do_overlap(boxes[a], boxes[b]) || !compatible(cells[a], cells[b])) continue;
+                if (m_control) m_control->check();
+
+                CGAL::Polyhedron_3<ExactKernel> hull;
+                if (!isConvexUnion(cells[a].geometry, cells[b].geometry, hull)) continue;
+                cells[a].geometry = std::move(hull);
+                cells[a].planes.insert(cells[b].planes.begin(), cells[b].planes.end());
+                cells[a].seen.insert(cells[b].seen.begin(), cells[b].seen.end());
+                boxes[a] += boxes[b];
+                alive[b] = false;
+                merged = true;
+            }
+        }
     }
-    
-    const ExactKernel::Plane_3& exact_plane = m_exactPlanes[planeIndex];
-    Nef_polyhedron plane_nef(exact_plane, Nef_polyhedron::INCLUDED);
-    
-    Nef_polyhedron positive_space = space * plane_nef;
-    if (!positive_space.is_empty() && positive_space.number_of_vertices() > 0) {
-        std::set<size_t> pos_planes;
-        if (!nefPolys.empty()) {
-            pos_planes = nefPolys.back().second;
+
+    std::vector<BlockCell> stitched;
+    for (size_t i = 0; i < cells.size(); i++) {
+        if (alive[i]) stitched.push_back(std::move(cells[i]));
+    }
+    cells = std::move(stitched);
+    std::cout << "Stitched " << before << " block cells into " << cells.size() << std::endl;
+}
+
+bool SpacePartitioner::isConvexUnion(const CGAL::Polyhedron_3<ExactKernel>& a,
+                                     const CGAL::Polyhedron_3<ExactKernel>& b,
+                                     CGAL::Polyhedron_3<ExactKernel>& hull) {
+    std::vector<ExactKernel::Point_3> points(a.points_begin(), a.points_end());
+    points.insert(points.end(), b.points_begin(), b.points_end());
+    CGAL::convex_hull_3(points.begin(), points.end(), hull);
+
+    // The union is convex exactly when nothing of the hull lies outside both cells
+    Nef_polyhedron rest = Nef_polyhedron(hull) - Nef_polyhedron(a) - Nef_polyhedron(b);
+    return rest.regularization().is_empty();
+}
+
+void SpacePartitioner::groupCoplanarPlanes() {
+    m_planeGroups.clear();
+    m_flippedInGroup.assign(m_contourPlanes.size(), false);
+    for (size_t i = 0; i < m_contourPlanes.size(); i++) {
+        const Plane& plane = m_contourPlanes[i].plane();
+        auto group = std::find_if(m_planeGroups.begin(), m_planeGroups.end(),
+            [&](const std::vector<size_t>& members) {
+                const Plane& representative = m_contourPlanes[members.front()].plane();
+                return sameSupportingPlane(representative, plane) ||
+                       (m_planeMergeTolerance > 0.0 &&
+                        nearlySamePlane(representative, plane, m_planeMergeTolerance));
+            });
+        if (group == m_planeGroups.end()) {
+            m_planeGroups.push_back({i});
+        } else {
+            const Plane& representative = m_contourPlanes[group->front()].plane();
+            m_flippedInGroup[i] = representative.orthogonal_vector() * plane.orthogonal_vector() < 0;
+            group->push_back(i);
         }
-        pos_planes.insert(planeIndex);
-        partitionSpace(positive_space, planeIndex + 1, nefPolys);
-        if (!nefPolys.empty()) {
-            nefPolys.back().second = pos_planes;
+    }
+
+    if (getSavedSplits() > 0) {
+        std::cout << "Merged " << m_contourPlanes.size() << " contour planes into "
+                  << m_planeGroups.size() << " splitting planes, saving "
+                  << getSavedSplits() << " splits" << std::endl;
+    }
+}
+
+size_t SpacePartitioner::estimateSplitCount(size_t planeCount) {
+    // Planes in general position cut space into C(k,0)+C(k,1)+C(k,2)+C(k,3)
+    // cells, and plane k splits each cell left by the first k planes at most once
+    size_t total = 0;
+    for (size_t k = 0; k < planeCount; k++) {
+        total += 1 + k + k * (k - 1) / 2 + (k >= 2 ? k * (k - 1) * (k - 2) / 6 : 0);
+    }
+    return total;
+}
+
+void SpacePartitioner::precomputePlanes() {
+    // The first contour of each group supplies the splitting plane
+    IK_to_EK to_exact;
+    m_exactPlanes.clear();
+    m_exactPlanes.reserve(m_planeGroups.size());
+    for (const auto& members : m_planeGroups) {
+        m_exactPlanes.push_back(to_exact(m_contourPlanes[members.front()].plane()));
+    }
+}
+
+void SpacePartitioner::partitionSpace(Nef_polyhedron space, const std::vector<size_t>& planes,
+                                      NefCells& cells) {
+    // Depth first, positive side before negative: the stack holds at most one
+    // pending piece per plane and candidates come out in the usual order
+    std::vector<PendingSplit> pending;
+    size_t pendingSpilled = 0, cellsSpilled = 0;
+    NefCell root;
+    root.nef = std::make_unique<Nef_polyhedron>(std::move(space));
+    pending.push_back({std::move(root), 0});
+
+    while (!pending.empty()) {
+        if (m_control) m_control->check();
+        PendingSplit split = std::move(pending.back());
+        pending.pop_back();
+        pendingSpilled = std::min(pendingSpilled, pending.size());
+        Nef_polyhedron piece = restore(split.piece);
+        if (piece.is_empty() || piece.number_of_vertices() == 0) continue;
+
+        if (split.position >= planes.size()) {
+            // Candidate cell: keep what the filter needs to avoid loading it
+            CGAL::Polyhedron_3<ExactKernel> poly;
+            piece.convert_to_polyhedron(poly);
+            split.piece.vertexCount = poly.size_of_vertices();
+            for (auto p = poly.points_begin(); p != poly.points_end(); ++p) {
+                double x = CGAL::to_double(p->x()), y = CGAL::to_double(p->y()), z = CGAL::to_double(p->z());
+                split.piece.bbox += CGAL::Bbox_3(x, y, z, x, y, z);
+            }
+            const CGAL::Bbox_3& b = split.piece.bbox;
+            double pad = 1e-9 * (1.0 + std::max({b.xmax() - b.xmin(), b.ymax() - b.ymin(), b.zmax() - b.zmin()}));
+            split.piece.bbox = CGAL::Bbox_3(b.xmin() - pad, b.ymin() - pad, b.zmin() - pad,
+                                            b.xmax() + pad, b.ymax() + pad, b.zmax() + pad);
+            split.piece.nef = std::make_unique<Nef_polyhedron>(std::move(piece));
+            cells.push_back(std::move(split.piece));
+            enforceSpillLimit(pending, pendingSpilled, cells, cellsSpilled);
+            continue;
+        }
+
+        size_t planeIndex = planes[split.position];
+        Nef_polyhedron positive;
+        {
+            TRACE_SCOPE_ARG("partitionSpace", "plane", planeIndex);
+            positive = splitByPlane(piece, m_exactPlanes[planeIndex]);
+        }
+        if (m_control) {
+            size_t done = ++m_splitsDone;
+            m_control->report("partition", done, std::max(done, m_estimatedSplits));
         }
+
+        NefCell negativeSide;
+        negativeSide.nef = std::make_unique<Nef_polyhedron>(std::move(piece));
+        NefCell positiveSide;
+        positiveSide.nef = std::make_unique<Nef_polyhedron>(std::move(positive));
+        assignSplitSides(planeIndex, split.piece.planes, positiveSide, negativeSide);
+        pending.push_back({std::move(negativeSide), split.position + 1});
+        pending.push_back({std::move(positiveSide), split.position + 1});
+
+        enforceSpillLimit(pending, pendingSpilled, cells, cellsSpilled);
     }
-    
-    space *= plane_nef.complement();
-    if (!space.is_empty() && space.number_of_vertices() > 0) {
-        partitionSpace(space, planeIndex + 1, nefPolys);
+}
+
+void SpacePartitioner::assignSplitSides(size_t group, const std::set<size_t>& parentPlanes,
+                                        NefCell& positive, NefCell& negative) const {
+    negative.planes = parentPlanes;
+    positive.planes = parentPlanes;
+    for (size_t member : m_planeGroups[group]) {
+        (m_flippedInGroup[member] ? negative : positive).planes.insert(member);
+    }
+}
+
+void SpacePartitioner::enforceSpillLimit(std::vector<PendingSplit>& pending, size_t& pendingSpilled,
+                                         NefCells& cells, size_t& cellsSpilled) {
+    if (m_spillLimit <= 0) return;
+
+    // Candidates are not touched again until the filter, so they go first;
+    // pending pieces deepest in the stack are needed last
+    while (cellsSpilled < cells.size() && getMemoryReport().totalLiveBytes > m_spillLimit) {
+        spill(cells[cellsSpilled++]);
+    }
+    while (pendingSpilled + 1 < pending.size() && getMemoryReport().totalLiveBytes > m_spillLimit) {
+        spill(pending[pendingSpilled++].piece);
+    }
+}
+
+void SpacePartitioner::spill(NefCell& cell) {
+    if (!cell.nef) return;
+    TRACE_SCOPE("spillPiece");
+    std::error_code ignored;
+    fs::create_directories(m_spillDir, ignored);
+    cell.spillPath = m_spillDir + "/piece_" + std::to_string(m_spillFiles++) + ".nef";
+
+    // The SNC format keeps the exact coordinates
+    std::ofstream file(cell.spillPath);
+    file << *cell.nef;
+    if (!file) {
+        throw std::runtime_error("Could not spill to " + cell.spillPath);
     }
+    cell.nef.reset();
+    m_spilledPieces++;
+}
+
+Nef_polyhedron SpacePartitioner::restore(NefCell& cell) const {
+    if (cell.nef) {
+        Nef_polyhedron nef = std::move(*cell.nef);
+        cell.nef.reset();
+        return nef;
+    }
+    Nef_polyhedron nef = peek(cell);
+    std::error_code ignored;
+    fs::remove(cell.spillPath, ignored);
+    cell.spillPath.clear();
+    return nef;
+}
+
+Nef_polyhedron SpacePartitioner::peek(const NefCell& cell) const {
+    if (cell.nef) return *cell.nef;
+    std::ifstream file(cell.spillPath);
+    if (!file) {
+        throw std::runtime_error("Could not read spilled piece " + cell.spillPath);
+    }
+    Nef_polyhedron nef;
+    file >> nef;
+    if (!file) {
+        throw std::runtime_error("Spilled piece is truncated or corrupt: " + cell.spillPath);
+    }
+    return nef;
+}
+
+Nef_polyhedron SpacePartitioner::splitByPlane(Nef_polyhedron& space, const ExactKernel::Plane_3& plane) {
+    Nef_polyhedron plane_nef(plane, Nef_polyhedron::INCLUDED);
+    Nef_polyhedron positive_space = space * plane_nef;
+    space *= plane_nef.complement();
+    return positive_space;
+}
+
+bool SpacePartitioner::coversCell(const Nef_polyhedron& cell, size_t cellVertexCount,
+                                  const Nef_polyhedron& other) {
+    Nef_polyhedron intersection = cell * other;
+    if (intersection.is_empty()) return false;
+
+    CGAL::Polyhedron_3<ExactKernel> poly_intersection;
+    intersection.convert_to_polyhedron(poly_intersection);
+    return poly_intersection.size_of_vertices() == cellVertexCount;
 }
 
 std::vector<ContourPlane> SpacePartitioner::getPlanesForCell(size_t cellIndex) const {
@@ -239,29 +785,3 @@ std::vector<ContourPlane> SpacePartitioner::getPlanesForCell(size_t cellIndex) c
     }
     return planes;
 }
-
-
-void SpacePartitioner::renderPolyhedron(const ConvexCell& cell, bool highlight) const {
-    EK_to_IK to_inexact;
-    
-    if (highlight) {
-        glColor3f(1.0f, 0.0f, 0.0f); // Red for highlighted cells
-    } else {
-        glColor3f(0.0f, 0.0f, 1.0f); // Blue for normal cells
-    }
-    glLineWidth(2.0f);
-
-    for (auto e = cell.geometry.edges_begin(); e != cell.geometry.edges_end(); ++e) {
-        Point v1 = to_inexact(e->vertex()->point());
-        Point v2 = to_inexact(e->opposite()->vertex()->point());
-
-        glBegin(GL_LINES);
-        glVertex3d(CGAL::to_double(v1.x()), 
-                  CGAL::to_double(v1.y()), 
-                  CGAL::to_double(v1.z()));
-        glVertex3d(CGAL::to_double(v2.x()), 
-                  CGAL::to_double(v2.y()), 
-                  CGAL::to_double(v2.z()));
-        glEnd();
-    }
-}
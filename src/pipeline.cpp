@@ -0,0 +1,80 @@
+// pipeline.cpp
+#include "pipeline.h"
+#include "trace.h"
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+PipelineContext::PipelineContext(const PipelineOptions& options)
+    : m_options(options), m_pool(options.threads), m_scratch(m_pool.size()) {
+    if (options.partitionThreads > 0) {
+        m_partitionPool = std::make_unique<ThreadPool>(options.partitionThreads);
+    }
+}
+
+PipelineResult PipelineContext::run(const std::string& filePath, const RunHooks& hooks) {
+    resetMemoryPeaks();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ContourPlane> contourPlanes = parseContourFile(filePath);
+    return run(std::move(contourPlanes), elapsedMs(start), hooks);
+}
+
+PipelineResult PipelineContext::run(std::vector<ContourPlane> contourPlanes, double parseMs,
+                                    const RunHooks& hooks) {
+    TRACE_SCOPE("PipelineContext::run");
+    if (contourPlanes.empty()) {
+        throw std::runtime_error("No contour planes in file");
+    }
+
+    RunControl control(hooks.cancel, m_options.budget, hooks.progress);
+    PipelineResult result;
+    result.contourPlanes = std::move(contourPlanes);
+    result.timings.parseMs = parseMs;
+
+    if (m_options.simplifyTolerance > 0.0) {
+        auto start = std::chrono::steady_clock::now();
+        result.simplification = simplifyContours(result.contourPlanes, m_options.simplifyTolerance);
+        result.timings.simplifyMs = elapsedMs(start);
+        std::cout << "Simplified contours from " << result.simplification.inputVertices << " to "
+                  << result.simplification.outputVertices << " vertices ("
+                  << result.simplification.reduction() * 100.0 << "% fewer)" << std::endl;
+    } else {
+        for (const auto& plane : result.contourPlanes) {
+            result.simplification.inputVertices += plane.vertexCount();
+        }
+        result.simplification.outputVertices = result.simplification.inputVertices;
+    }
+
+    if (hooks.stream) {
+        hooks.stream->begin(result.contourPlanes);
+    }
+
+    result.partitioner = std::make_unique<SpacePartitioner>(result.contourPlanes);
+    result.partitioner->setCacheDirectory(m_options.cacheDir);
+    if (m_options.simplifyTolerance > 0.0) {
+        // Dropped vertices can shrink the bounding box the cells are cut from
+        // Full precision, so every distinct tolerance gets its own entry
+        std::ostringstream tag;
+        tag << "_simplify" << std::setprecision(17) << m_options.simplifyTolerance;
+        result.partitioner->setCacheTag(tag.str());
+    }
+    result.partitioner->setPlaneMergeTolerance(m_options.planeMergeTolerance);
+    result.partitioner->setBlockDecomposition(m_options.octreeDepth, m_options.octreeBlockPlanes);
+    result.partitioner->setThreadPool(m_partitionPool ? m_partitionPool.get() : &m_pool);
+    result.partitioner->setSpillLimit(m_options.spillLimitBytes);
+    result.partitioner->setRunControl(&control);
+    result.partitioner->partition();
+    result.timings.partitionMs = result.partitioner->getPartitionMs();
+    result.timings.filterMs = result.partitioner->getFilterMs();
+    result.timings.cellsFromCache = result.partitioner->loadedFromCache();
+
+    auto start = std::chrono::steady_clock::now();
+    result.projection = std::make_unique<Projection>(*result.partitioner, &m_pool, &m_scratch, hooks.stream, &control,
+                                                     m_options.facetExtraction);
+    result.timings.projectionMs = elapsedMs(start);
+    result.memory = getMemoryReport();
+    result.partitioner->setRunControl(nullptr);  // control ends with this call
+
+    return result;
+}
@@ -1,40 +1,67 @@
 // projection.cpp
 #include "projection.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <stdexcept>
 #include <vector>
 #include <CGAL/Polyhedron_3.h>
 #include <CGAL/bounding_box.h>
 #include <CGAL/Cartesian_converter.h>
-#include <GL/glew.h>
+#include "cell_stream.h"
+#include "memory_stats.h"
 #include "partition.h"
+#include "trace.h"
 
-Projection::Projection(const SpacePartitioner& partitioner) {
+ReconstructionScratch::ReconstructionScratch()
+    : arenaBuffer(new std::byte[ARENA_BYTES]),
+      arena(std::make_unique<std::pmr::monotonic_buffer_resource>(arenaBuffer.get(), ARENA_BYTES)) {}
+
+FacetExtraction parseFacetExtraction(const std::string& name) {
+    if (name == "all") return FacetExtraction::All;
+    if (name == "hull") return FacetExtraction::Hull;
+    if (name == "material") return FacetExtraction::Material;
+    throw std::runtime_error("Unknown facet extraction: " + name);
+}
+
+Projection::Projection(const SpacePartitioner& partitioner,
+                       ThreadPool* pool,
+                       std::vector<ReconstructionScratch>* scratch,
+                       CellStream* stream,
+                       RunControl* control,
+                       FacetExtraction extraction)
+    : m_facetExtraction(extraction) {
+    MemoryStageScope memoryStage(MemoryStage::Projection);
     m_cells = partitioner.getConvexCells();
-    
-    for (size_t i = 0; i < m_cells.size(); i++) {
-        auto planes = partitioner.getPlanesForCell(i);
-        for (const auto& plane : planes) {
-            auto it = std::find(m_contourPlanes.begin(), m_contourPlanes.end(), plane);
-            if (it == m_contourPlanes.end()) {
-                m_contourPlanes.push_back(plane);
-            }
+    // In the partitioner's order, so a cell's planeIndices index every per-plane array
+    m_contourPlanes = partitioner.getContourPlanes();
+
+    {
+        TRACE_SCOPE_ARG("computeAxisPlanes", "cells", m_cells.size());
+        for (size_t i = 0; i < m_cells.size(); i++) {
+            m_cellPlanes[i] = computeAxisAlignedPlanes(m_cells[i].mesh.bbox);
         }
-        m_cellPlanes[i] = computeAxisAlignedPlanes(m_cells[i].geometry);
     }
+    buildSegmentTrees();
+    convertExtendedMeshes();
 
-    computeProjections();
+    computeProjections(pool, scratch, stream, control);
 }
 
-AxisPlanes Projection::computeAxisAlignedPlanes(const CGAL::Polyhedron_3<ExactKernel>& poly) const {
+AxisPlanes Projection::computeAxisAlignedPlanes(const CGAL::Bbox_3& bbox) const {
     AxisPlanes result;
     
-    auto bbox = CGAL::bounding_box(poly.points_begin(), poly.points_end());
-    double xmin = CGAL::to_double(bbox.xmin());
-    double ymin = CGAL::to_double(bbox.ymin());
-    double zmin = CGAL::to_double(bbox.zmin());
-    double xmax = CGAL::to_double(bbox.xmax());
-    double ymax = CGAL::to_double(bbox.ymax());
-    double zmax = CGAL::to_double(bbox.zmax());
+    double xmin = bbox.xmin();
+    double ymin = bbox.ymin();
+    double zmin = bbox.zmin();
+    double xmax = bbox.xmax();
+    double ymax = bbox.ymax();
+    double zmax = bbox.zmax();
 
     double xcenter = (xmin + xmax) / 2;
     double ycenter = (ymin + ymax) / 2;
@@ -76,43 +103,6 @@ AxisPlanes Projection::computeAxisAlignedPlanes(const CGAL::Polyhedron_3<ExactKe
     return result;
 }
 
-void Projection::renderAxisPlanes(const AxisPlanes& planes) const {
-    glColor3f(1.0f, 0.75f, 0.8f);
-    glBegin(GL_QUADS);
-    for (const auto& plane : planes.planes) {
-        for (const auto& corner : plane.corners) {
-            glVertex3d(CGAL::to_double(corner.x()),
-                      CGAL::to_double(corner.y()),
-                      CGAL::to_double(corner.z()));
-        }
-    }
-    glEnd();
-}
-
-void Projection::renderPlanesForAllCells() const {
-    for (size_t i = 0; i < m_cells.size(); i++) {
-        auto it = m_cellPlanes.find(i);
-        if (it != m_cellPlanes.end()) {
-            renderAxisPlanes(it->second);
-        }
-    }
-}
-
-void Projection::renderPlanesForCell(const CGAL::Polyhedron_3<ExactKernel>& poly) const {
-    size_t cellIndex = 0;
-    for (size_t i = 0; i < m_cells.size(); i++) {
-        if (&m_cells[i].geometry == &poly) {
-            cellIndex = i;
-            break;
-        }
-    }
-    
-    auto it = m_cellPlanes.find(cellIndex);
-    if (it != m_cellPlanes.end()) {
-        renderAxisPlanes(it->second);
-    }
-}
-
 const AxisPlanes& Projection::getAxisPlanesForCell(size_t cellIndex) const {
     auto it = m_cellPlanes.find(cellIndex);
     if (it == m_cellPlanes.end()) {
@@ -122,6 +112,11 @@ const AxisPlanes& Projection::getAxisPlanesForCell(size_t cellIndex) const {
     return it->second;
 }
 
+size_t Projection::getUniformCellCount() const {
+    return std::count_if(m_uniformMaterials.begin(), m_uniformMaterials.end(),
+                         [](int material) { return material != -1; });
+}
+
 std::vector<ContourPlane> Projection::getPlanesForCell(size_t cellIndex) const {
     if (cellIndex >= m_cells.size()) return {};
     
@@ -172,7 +167,7 @@ const AxisPlanes::Plane* Projection::selectProjectionPlane(
     const AxisPlanes::Plane* bestPlane = nullptr;
     
     for (const auto& plane : axisPlanes.planes) {
-        double dot = computePlaneDotProduct(contourPlane.plane, plane);
+        double dot = computePlaneDotProduct(contourPlane.plane(), plane);
         // Find distance from +1 instead of -1
         double distFromOne = std::abs(dot - 1.0);
         if (distFromOne < minDist) {
@@ -231,12 +226,13 @@ ReconstructedMesh Projection::triangulateVertices(const std::vector<Point>& poin
         vertex_indices[points[i]] = i;
     }
 
-    // Extract finite facets
+    // Extract the hull facets; there is no contour here to classify material by
     for(auto fit = T.finite_facets_begin(); fit != T.finite_facets_end(); ++fit) {
         std::array<size_t, 3> triangle;
         
         Triangulation::Cell_handle cell = fit->first;
         int i = fit->second;
+        if (T.dimension() == 3 && !T.is_infinite(cell) && !T.is_infinite(cell->neighbor(i))) continue;
         
         for(int j = 0; j < 3; j++) {
             Point p = cell->vertex(T.vertex_triple_index(i, j))->point();
@@ -261,56 +257,263 @@ ReconstructedMesh Projection::triangulateVertices(const std::vector<Point>& poin
     return result;
 }
 
-void Projection::computeProjections() {
-    m_projectedContours.clear();
+void Projection::buildSegmentTrees() {
+    TRACE_SCOPE_ARG("buildSegmentTrees", "planes", m_contourPlanes.size());
+    m_contourSegments.assign(m_contourPlanes.size(), ContourSegments());
+    m_segmentTrees.clear();
+    m_planeMaterials.assign(m_contourPlanes.size(), -1);
+    for (size_t i = 0; i < m_contourPlanes.size(); i++) {
+        const ContourPlane& plane = m_contourPlanes[i];
+        ContourSegments& segments = m_contourSegments[i];
+        segments.reserve(plane.edgeCount());
+        std::set<int> materials;
+        for (size_t e = 0; e < plane.edgeCount(); e++) {
+            auto [v1, v2] = plane.edge(e);
+            if (std::max(v1, v2) >= plane.vertexCount()) continue;
+            auto [m1, m2] = plane.edgeMaterials(e);
+            materials.insert(m1);
+            materials.insert(m2);
+            if (m1 == m2) continue;  // Interior to one material: never on the surface
+            segments.emplace_back(plane.vertex(v1), plane.vertex(v2));
+        }
+        if (segments.empty() && materials.size() == 1) {
+            m_planeMaterials[i] = *materials.begin();
+        }
 
-    for (size_t cellIdx = 0; cellIdx < m_cells.size(); cellIdx++) {
-        CellProjections cellProj;
-        cellProj.cellIndex = cellIdx;
-
-        auto contourPlanes = getPlanesForCell(cellIdx);
-        const auto& axisPlanes = getAxisPlanesForCell(cellIdx);
-
-        // First check for extended mesh data
-        bool hasExtendedMesh = false;
-        for (const auto& contourPlane : contourPlanes) {
-            if (contourPlane.hasExt) {
-                ProjectedContour proj;
-                proj.originalPlane = &contourPlane;
-                proj.useExtendedMesh = true;
-                proj.reconstructedSurface = convertExtendedToReconstructedMesh(contourPlane.extMesh);
-                cellProj.projections.push_back(proj);
-                hasExtendedMesh = true;
-                break;
+        // Trees build lazily on first query, which must not happen on the pool
+        auto tree = std::make_unique<SegmentTree>(segments.begin(), segments.end());
+        tree->build();
+        m_segmentTrees.push_back(std::move(tree));
+    }
+}
+
+std::vector<Projection::Halfspace> Projection::computeCellHalfspaces(const SpacePartitioner::CellMesh& mesh) {
+    std::vector<Halfspace> halfspaces;
+    if (mesh.vertices.empty()) return halfspaces;
+
+    InexactKernel::Vector_3 centroid(0, 0, 0);
+    for (const auto& v : mesh.vertices) {
+        centroid = centroid + InexactKernel::Vector_3(v[0], v[1], v[2]);
+    }
+    centroid = centroid / static_cast<double>(mesh.vertices.size());
+
+    for (size_t f = 0; f + 1 < mesh.faceOffsets.size(); f++) {
+        // Newell normal and face centroid tolerate slightly non-planar rounding
+        double nx = 0, ny = 0, nz = 0;
+        InexactKernel::Vector_3 faceCenter(0, 0, 0);
+        uint32_t begin = mesh.faceOffsets[f], end = mesh.faceOffsets[f + 1];
+        for (uint32_t k = begin; k < end; k++) {
+            const auto& a = mesh.vertices[mesh.faceIndices[k]];
+            const auto& b = mesh.vertices[mesh.faceIndices[k + 1 < end ? k + 1 : begin]];
+            nx += (a[1] - b[1]) * (a[2] + b[2]);
+            ny += (a[2] - b[2]) * (a[0] + b[0]);
+            nz += (a[0] - b[0]) * (a[1] + b[1]);
+            faceCenter = faceCenter + InexactKernel::Vector_3(a[0], a[1], a[2]);
+        }
+        if (end == begin) continue;
+        faceCenter = faceCenter / static_cast<double>(end - begin);
+
+        InexactKernel::Vector_3 normal(nx, ny, nz);
+        double length = std::sqrt(normal.squared_length());
+        if (length == 0.0) continue;
+        normal = normal / length;
+        if (normal * (centroid - faceCenter) > 0) normal = -normal;  // Point outward
+        halfspaces.push_back({normal, normal * faceCenter});
+    }
+    return halfspaces;
+}
+
+void Projection::clipContourToCell(size_t planeIdx, const SpacePartitioner::CellMesh& mesh,
+                                   const std::vector<Halfspace>& halfspaces,
+                                   std::vector<Point>& clipped) const {
+    clipped.clear();
+    const CGAL::Bbox_3& bbox = mesh.bbox;
+    // Contours lie on cell faces, so boundary tests need a little slack
+    double eps = 1e-9 * std::max(1.0, std::sqrt(CGAL::square(bbox.xmax() - bbox.xmin()) +
+                                                CGAL::square(bbox.ymax() - bbox.ymin()) +
+                                                CGAL::square(bbox.zmax() - bbox.zmin())));
+    auto inside = [&](const Point& p) {
+        InexactKernel::Vector_3 v = p - CGAL::ORIGIN;
+        for (const auto& h : halfspaces) {
+            if (h.normal * v > h.offset + eps) return false;
+        }
+        return true;
+    };
+
+    const ContourPlane& plane = m_contourPlanes[planeIdx];
+    if (plane.edgeCount() == 0) {
+        // No edges to clip; keep the loose vertices that fall in the cell
+        for (const Point& p : plane.vertices()) {
+            if (inside(p)) clipped.push_back(p);
+        }
+    } else if (!m_contourSegments[planeIdx].empty()) {
+        InexactKernel::Iso_cuboid_3 query(bbox.xmin() - eps, bbox.ymin() - eps, bbox.zmin() - eps,
+                                          bbox.xmax() + eps, bbox.ymax() + eps, bbox.zmax() + eps);
+        std::vector<SegmentTree::Primitive_id> candidates;
+        m_segmentTrees[planeIdx]->all_intersected_primitives(query, std::back_inserter(candidates));
+
+        // Cyrus-Beck against every face of the convex cell
+        for (const auto& id : candidates) {
+            const Point& p0 = id->source();
+            InexactKernel::Vector_3 d = id->target() - p0;
+            InexactKernel::Vector_3 v0 = p0 - CGAL::ORIGIN;
+            double t0 = 0.0, t1 = 1.0;
+            bool rejected = false;
+            for (const auto& h : halfspaces) {
+                double num = h.offset + eps - h.normal * v0;
+                double den = h.normal * d;
+                if (den == 0.0) {
+                    rejected = num < 0.0;
+                } else if (den > 0.0) {
+                    t1 = std::min(t1, num / den);
+                } else {
+                    t0 = std::max(t0, num / den);
+                }
+                if (rejected || t0 > t1) {
+                    rejected = true;
+                    break;
+                }
             }
+            if (rejected) continue;
+            clipped.push_back(t0 == 0.0 ? p0 : p0 + t0 * d);
+            clipped.push_back(t1 == 1.0 ? id->target() : p0 + t1 * d);
         }
+    }
+
+    std::sort(clipped.begin(), clipped.end());
+    clipped.erase(std::unique(clipped.begin(), clipped.end()), clipped.end());
+}
+
+void Projection::computeProjections(ThreadPool* pool, std::vector<ReconstructionScratch>* scratch,
+                                    CellStream* stream, RunControl* control) {
+    TRACE_SCOPE("computeProjections");
+    m_projectedContours.clear();
 
-        // Only proceed with normal reconstruction if no extended mesh was found
-        if (!hasExtendedMesh) {
-            for (const auto& contourPlane : contourPlanes) {
-                // Find best projection plane
-                const AxisPlanes::Plane* projPlane = selectProjectionPlane(contourPlane, axisPlanes);
-                if (!projPlane) continue;
-
-                ProjectedContour proj;
-                proj.originalPlane = &contourPlane;
-                proj.projectionPlane = projPlane;
-                
-                // Project vertices onto selected plane
-                proj.projectedVertices = projectVerticesOntoPlane(contourPlane.vertices, *projPlane);
-
-                // Reconstruct surface using original and projected vertices
-                proj.reconstructedSurface = reconstructCellSurface(
-                    contourPlane.vertices,
-                    proj.projectedVertices
-                );
-
-                cellProj.projections.push_back(proj);
+    std::vector<ReconstructionScratch> localScratch;
+    if (!scratch) {
+        localScratch.resize(pool ? pool->size() : 1);
+        scratch = &localScratch;
+    }
+
+    // Cells are independent; results land in per-cell slots so the order matches a serial run
+    std::vector<CellProjections> perCell(m_cells.size());
+    std::atomic<size_t> cellsDone{0};
+    auto task = [&](size_t cellIdx, size_t slot) {
+        if (control) control->check();  // A throw here skips the remaining cells
+        perCell[cellIdx] = projectCell(cellIdx, (*scratch)[slot]);
+        if (control) control->report("reconstruct", ++cellsDone, m_cells.size());
+        if (stream) {
+            StreamedCell streamed;
+            streamed.cellIndex = cellIdx;
+            streamed.mesh = m_cells[cellIdx].mesh;
+            for (const auto& proj : perCell[cellIdx].projections) {
+                streamed.surfaces.push_back(proj.reconstructedSurface);
             }
+            stream->push(std::move(streamed));
+        }
+    };
+    if (pool) {
+        pool->parallelFor(m_cells.size(), task);
+    } else {
+        for (size_t cellIdx = 0; cellIdx < m_cells.size(); cellIdx++) {
+            task(cellIdx, 0);
         }
+    }
 
+    m_uniformMaterials.assign(m_cells.size(), -1);
+    for (auto& cellProj : perCell) {
+        m_uniformMaterials[cellProj.cellIndex] = cellProj.uniformMaterial;
         if (!cellProj.projections.empty()) {
-            m_projectedContours.push_back(cellProj);
+            m_projectedContours.push_back(std::move(cellProj));
+        }
+    }
+}
+
+CellProjections Projection::projectCell(size_t cellIdx, ReconstructionScratch& scratch) const {
+    TRACE_SCOPE_ARG("reconstructCell", "cell", cellIdx);
+    MemoryStageScope memoryStage(MemoryStage::Projection);  // Runs on pool workers too
+    scratch.reset();
+    CellProjections cellProj;
+    cellProj.cellIndex = cellIdx;
+
+    std::vector<const ContourPlane*> contourPlanes;
+    std::vector<size_t> contourIndices;
+    for (size_t planeIdx : m_cells[cellIdx].planeIndices) {
+        if (planeIdx < m_contourPlanes.size()) {
+            contourPlanes.push_back(&m_contourPlanes[planeIdx]);
+            contourIndices.push_back(planeIdx);
+        }
+    }
+    const auto& axisPlanes = getAxisPlanesForCell(cellIdx);
+
+    // First check for extended mesh data
+    for (size_t i = 0; i < contourPlanes.size(); i++) {
+        const ContourPlane* contourPlane = contourPlanes[i];
+        if (contourPlane->hasExt()) {
+            ProjectedContour proj;
+            proj.originalPlane = contourPlane;
+            proj.projectionPlane = nullptr;
+            proj.useExtendedMesh = true;
+            proj.reconstructedSurface = m_extendedSurfaces[contourIndices[i]];
+            cellProj.projections.push_back(std::move(proj));
+            return cellProj;
+        }
+    }
+
+    // A cell whose contours all lie within one material holds no surface
+    if (!contourIndices.empty()) {
+        int material = m_planeMaterials[contourIndices[0]];
+        for (size_t planeIdx : contourIndices) {
+            if (m_planeMaterials[planeIdx] != material) material = -1;
+        }
+        if (material != -1) {
+            cellProj.uniformMaterial = material;
+            return cellProj;
+        }
+    }
+
+    // Only proceed with normal reconstruction if no extended mesh was found
+    std::vector<Halfspace> halfspaces = computeCellHalfspaces(m_cells[cellIdx].mesh);
+    for (size_t i = 0; i < contourPlanes.size(); i++) {
+        const ContourPlane* contourPlane = contourPlanes[i];
+        // Find best projection plane
+        const AxisPlanes::Plane* projPlane = selectProjectionPlane(*contourPlane, axisPlanes);
+        if (!projPlane) continue;
+
+        // Only the part of the contour inside this cell feeds its triangulation
+        std::vector<Point>& clipped = scratch.clippedPoints;
+        clipContourToCell(contourIndices[i], m_cells[cellIdx].mesh, halfspaces, clipped);
+        if (clipped.empty()) continue;
+
+        ProjectedContour proj;
+        proj.originalPlane = contourPlane;
+        proj.projectionPlane = projPlane;
+
+        // Project vertices onto selected plane
+        proj.projectedVertices = projectVerticesOntoPlane(clipped, *projPlane);
+
+        // Reconstruct surface using original and projected vertices
+        proj.reconstructedSurface = std::make_shared<ReconstructedMesh>(reconstructCellSurface(
+            clipped,
+            proj.projectedVertices,
+            *contourPlane,
+            *projPlane,
+            scratch
+        ));
+
+        cellProj.projections.push_back(std::move(proj));
+    }
+
+    return cellProj;
+}
+
+void Projection::convertExtendedMeshes() {
+    TRACE_SCOPE("convertExtendedMeshes");
+    m_extendedSurfaces.assign(m_contourPlanes.size(), nullptr);
+    for (size_t i = 0; i < m_contourPlanes.size(); i++) {
+        if (m_contourPlanes[i].hasExt()) {
+            m_extendedSurfaces[i] = std::make_shared<ReconstructedMesh>(
+                convertExtendedToReconstructedMesh(m_contourPlanes[i].extMesh()));
         }
     }
 }
@@ -340,44 +543,110 @@ ReconstructedMesh Projection::convertExtendedToReconstructedMesh(const ExtendedM
     return result;
 }
 
+bool Projection::classifyInsideCells(const Triangulation& T, const ContourPlane& contour,
+                                     char axis, CellSet& inside) {
+    // Drop the projection axis: the sweep from contour to axis plane runs along it
+    int u = axis == 'x' ? 1 : 0;
+    int v = axis == 'z' ? 1 : 2;
+    std::vector<std::array<double, 4>> boundary;
+    for (size_t e = 0; e < contour.edgeCount(); e++) {
+        auto [a, b] = contour.edge(e);
+        if (std::max(a, b) >= contour.vertexCount()) continue;
+        if (contour.edgeMaterials(e)[0] == contour.edgeMaterials(e)[1]) continue;
+        Point p = contour.vertex(a);
+        Point q = contour.vertex(b);
+        boundary.push_back({p[u], p[v], q[u], q[v]});
+    }
+    if (boundary.empty()) return false;
+
+    inside.clear();
+    for (auto cit = T.finite_cells_begin(); cit != T.finite_cells_end(); ++cit) {
+        double cu = 0.0, cv = 0.0;
+        for (int i = 0; i < 4; i++) {
+            cu += cit->vertex(i)->point()[u] / 4;
+            cv += cit->vertex(i)->point()[v] / 4;
+        }
+        bool odd = false;
+        for (const auto& [au, av, bu, bv] : boundary) {
+            if ((av > cv) != (bv > cv) && cu < au + (cv - av) * (bu - au) / (bv - av)) {
+                odd = !odd;
+            }
+        }
+        if (odd) inside.insert(cit);
+    }
+    return true;
+}
+
+void Projection::extractTriangles(const Triangulation& T,
+                                  std::pmr::map<Point, size_t>& vertexIndices,
+                                  std::vector<std::array<size_t, 3>>& triangles,
+                                  FacetExtraction mode,
+                                  const CellSet* inside) {
+    triangles.clear();
+    if (T.dimension() < 3 || (mode == FacetExtraction::Material && !inside)) {
+        mode = FacetExtraction::All;
+    }
+    triangles.reserve(mode == FacetExtraction::All ? T.number_of_finite_facets() : T.number_of_vertices() * 2);
+    for (auto fit = T.finite_facets_begin(); fit != T.finite_facets_end(); ++fit) {
+        std::array<size_t, 3> triangle;
+
+        Triangulation::Cell_handle cell = fit->first;
+        int i = fit->second;
+        Triangulation::Cell_handle neighbor = cell->neighbor(i);
+
+        // Keep facets with different sides; the infinite cell counts as outside
+        if (mode == FacetExtraction::Hull) {
+            if (T.is_infinite(cell) == T.is_infinite(neighbor)) continue;
+        } else if (mode == FacetExtraction::Material) {
+            bool cellInside = inside->count(cell) > 0;
+            bool neighborInside = inside->count(neighbor) > 0;
+            if (cellInside == neighborInside) continue;
+        }
+
+        for (int j = 0; j < 3; j++) {
+            Point p = cell->vertex(T.vertex_triple_index(i, j))->point();
+            triangle[j] = vertexIndices[p];
+        }
+
+        triangles.push_back(triangle);
+    }
+}
+
 ReconstructedMesh Projection::reconstructCellSurface(
     const std::vector<Point>& originalVertices,
-    const std::vector<Point>& projectedVertices) const {
+    const std::vector<Point>& projectedVertices,
+    const ContourPlane& contour,
+    const AxisPlanes::Plane& projectionPlane,
+    ReconstructionScratch& scratch) const {
+    MemoryStageScope memoryStage(MemoryStage::Triangulation);
 
     ReconstructedMesh result;
 
-    // Combine original and projected vertices
-    std::vector<Point> combinedPoints;
+    // Combine original and projected vertices in the reused scratch buffer
+    std::vector<Point>& combinedPoints = scratch.combinedPoints;
+    combinedPoints.clear();
     combinedPoints.reserve(originalVertices.size() + projectedVertices.size());
     combinedPoints.insert(combinedPoints.end(), originalVertices.begin(), originalVertices.end());
     combinedPoints.insert(combinedPoints.end(), projectedVertices.begin(), projectedVertices.end());
 
     // Perform triangulation on combined points
-    typedef CGAL::Triangulation_3<InexactKernel> Triangulation;
     Triangulation T;
     T.insert(combinedPoints.begin(), combinedPoints.end());
 
-    // Create vertex index mapping using std::map instead of unordered_map
-    std::map<Point, size_t> vertex_indices;
+    // Create vertex index mapping; nodes come from the per-thread arena
+    std::pmr::map<Point, size_t> vertex_indices(scratch.arena.get());
     for (size_t i = 0; i < combinedPoints.size(); i++) {
         vertex_indices[combinedPoints[i]] = i;
     }
 
-    // Extract triangles from finite facets
-    result.triangles.clear();
-    for (auto fit = T.finite_facets_begin(); fit != T.finite_facets_end(); ++fit) {
-        std::array<size_t, 3> triangle;
-
-        Triangulation::Cell_handle cell = fit->first;
-        int i = fit->second;
-
-        for (int j = 0; j < 3; j++) {
-            Point p = cell->vertex(T.vertex_triple_index(i, j))->point();
-            triangle[j] = vertex_indices[p];
-        }
-
-        result.triangles.push_back(triangle);
+    // Keep the boundary facets chosen by the extraction mode
+    FacetExtraction mode = m_facetExtraction;
+    CellSet inside(scratch.arena.get());
+    if (mode == FacetExtraction::Material &&
+        (!classifyInsideCells(T, contour, projectionPlane.axis, inside) || inside.empty())) {
+        mode = FacetExtraction::Hull;
     }
+    extractTriangles(T, vertex_indices, result.triangles, mode, &inside);
 
     // Store vertices
     result.vertices = combinedPoints;
@@ -387,7 +656,9 @@ ReconstructedMesh Projection::reconstructCellSurface(
     mesh.clear();
 
     // Add vertices
-    std::vector<typename CGAL::Surface_mesh<Point>::Vertex_index> mesh_vertex_indices;
+    mesh.reserve(combinedPoints.size(), 3 * result.triangles.size(), result.triangles.size());
+    std::pmr::vector<typename CGAL::Surface_mesh<Point>::Vertex_index> mesh_vertex_indices(scratch.arena.get());
+    mesh_vertex_indices.reserve(combinedPoints.size());
     for (const auto& p : combinedPoints) {
         mesh_vertex_indices.push_back(mesh.add_vertex(p));
     }
@@ -406,13 +677,13 @@ ReconstructedMesh Projection::reconstructCellSurface(
 void Projection::reconstructSurface(ProjectedContour& projection) {
     // Combine original and projected vertices
     std::vector<Point> combinedPoints;
-    combinedPoints.reserve(projection.originalPlane->vertices.size() + 
+    combinedPoints.reserve(projection.originalPlane->vertexCount() + 
                          projection.projectedVertices.size());
     
     // Add original vertices
     combinedPoints.insert(combinedPoints.end(),
-                         projection.originalPlane->vertices.begin(),
-                         projection.originalPlane->vertices.end());
+                         projection.originalPlane->vertices().begin(),
+                         projection.originalPlane->vertices().end());
     
     // Add projected vertices
     combinedPoints.insert(combinedPoints.end(),
@@ -420,7 +691,8 @@ void Projection::reconstructSurface(ProjectedContour& projection) {
                          projection.projectedVertices.end());
 
     // Store combined vertices
-    projection.reconstructedSurface.vertices = combinedPoints;
+    ReconstructedMesh surface;
+    surface.vertices = combinedPoints;
 
     // Perform single triangulation on combined points
     typedef CGAL::Triangulation_3<InexactKernel> Triangulation;
@@ -434,7 +706,7 @@ void Projection::reconstructSurface(ProjectedContour& projection) {
     }
 
     // Extract triangles from finite facets
-    projection.reconstructedSurface.triangles.clear();
+    surface.triangles.clear();
     for(auto fit = T.finite_facets_begin(); fit != T.finite_facets_end(); ++fit) {
         std::array<size_t, 3> triangle;
         
@@ -446,11 +718,11 @@ void Projection::reconstructSurface(ProjectedContour& projection) {
             triangle[j] = vertex_indices[p];
         }
         
-        projection.reconstructedSurface.triangles.push_back(triangle);
+        surface.triangles.push_back(triangle);
     }
 
     // Create surface mesh
-    CGAL::Surface_mesh<Point>& mesh = projection.reconstructedSurface.mesh;
+    CGAL::Surface_mesh<Point>& mesh = surface.mesh;
     mesh.clear();
     
     // Add vertices
@@ -460,54 +732,50 @@ void Projection::reconstructSurface(ProjectedContour& projection) {
     }
     
     // Add faces
-    for (const auto& triangle : projection.reconstructedSurface.triangles) {
+    for (const auto& triangle : surface.triangles) {
         mesh.add_face(mesh_vertex_indices[triangle[0]], 
                      mesh_vertex_indices[triangle[1]], 
                      mesh_vertex_indices[triangle[2]]);
     }
+
+    projection.reconstructedSurface = std::make_shared<ReconstructedMesh>(std::move(surface));
 }
 
-void Projection::renderReconstructedSurface(const ReconstructedMesh& mesh) const {
-    // Simple solid color rendering without lighting
-    glDisable(GL_LIGHTING);
-    glColor3f(1.0f, 0.6f, 0.8f);  // Pink color
-    
-    glBegin(GL_TRIANGLES);
-    for(const auto& triangle : mesh.triangles) {
-        for(size_t idx : triangle) {
-            const Point& p = mesh.vertices[idx];
-            glVertex3d(CGAL::to_double(p.x()),
-                      CGAL::to_double(p.y()),
-                      CGAL::to_double(p.z()));
+bool Projection::saveReconstructedSurfaces(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    // Merge every reconstruction into a single OFF mesh
+    size_t vertexCount = 0;
+    size_t faceCount = 0;
+    for (const auto& cellProj : m_projectedContours) {
+        for (const auto& proj : cellProj.projections) {
+            vertexCount += proj.reconstructedSurface->vertices.size();
+            faceCount += proj.reconstructedSurface->triangles.size();
         }
     }
-    glEnd();
 
-    // Render edges
-    glLineWidth(1.0f);
-    glColor3f(0.0f, 0.0f, 0.0f);  // Black edges
-    
-    glBegin(GL_LINES);
-    for(const auto& triangle : mesh.triangles) {
-        for(int i = 0; i < 3; i++) {
-            const Point& p1 = mesh.vertices[triangle[i]];
-            const Point& p2 = mesh.vertices[triangle[(i + 1) % 3]];
-            
-            glVertex3d(CGAL::to_double(p1.x()),
-                      CGAL::to_double(p1.y()),
-                      CGAL::to_double(p1.z()));
-            glVertex3d(CGAL::to_double(p2.x()),
-                      CGAL::to_double(p2.y()),
-                      CGAL::to_double(p2.z()));
+    file << "OFF" << std::endl;
+    file << vertexCount << " " << faceCount << " 0" << std::endl;
+    for (const auto& cellProj : m_projectedContours) {
+        for (const auto& proj : cellProj.projections) {
+            for (const auto& p : proj.reconstructedSurface->vertices) {
+                file << p.x() << " " << p.y() << " " << p.z() << std::endl;
+            }
         }
     }
-    glEnd();
-}
 
-void Projection::renderAllReconstructions() const {
+    size_t offset = 0;
     for (const auto& cellProj : m_projectedContours) {
         for (const auto& proj : cellProj.projections) {
-            renderReconstructedSurface(proj.reconstructedSurface);
+            for (const auto& triangle : proj.reconstructedSurface->triangles) {
+                file << "3 " << triangle[0] + offset << " "
+                     << triangle[1] + offset << " "
+                     << triangle[2] + offset << std::endl;
+            }
+            offset += proj.reconstructedSurface->vertices.size();
         }
     }
-}
\ No newline at end of file
+
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,382 @@
+// render.cpp
+#include "render.h"
+#include "trace.h"
+#include <algorithm>
+#include <set>
+
+SceneRenderer::~SceneRenderer() {
+    release();
+}
+
+void SceneRenderer::release() {
+    for (DrawBatch* batch : {&m_contourLines, &m_cellLines, &m_surfaceTriangles, &m_surfaceEdges}) {
+        if (batch->ibo) glDeleteBuffers(1, &batch->ibo);
+        if (batch->vao) glDeleteVertexArrays(1, &batch->vao);
+        *batch = DrawBatch();
+    }
+    for (GLuint* vbo : {&m_contourVbo, &m_cellVbo, &m_surfaceVbo, &m_cellColorVbo}) {
+        if (*vbo) glDeleteBuffers(1, vbo);
+        *vbo = 0;
+    }
+}
+
+GLuint SceneRenderer::uploadVertices(const std::vector<float>& vertices) {
+    GLuint vbo = 0;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float),
+                 vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return vbo;
+}
+
+void SceneRenderer::uploadBatch(DrawBatch& batch, GLuint vbo, const std::vector<GLuint>& indices,
+                                GLuint colorVbo) {
+    glGenVertexArrays(1, &batch.vao);
+    glBindVertexArray(batch.vao);
+
+    // Fixed-function vertex array state is recorded in the VAO
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, 0, nullptr);
+
+    if (colorVbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, colorVbo);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(3, GL_FLOAT, 0, nullptr);
+    }
+
+    glGenBuffers(1, &batch.ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                 indices.data(), GL_STATIC_DRAW);
+    batch.indexCount = static_cast<GLsizei>(indices.size());
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneRenderer::drawBatch(const DrawBatch& batch, GLenum mode) const {
+    if (batch.indexCount == 0) return;
+    glBindVertexArray(batch.vao);
+    glDrawElements(mode, batch.indexCount, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+
+    m_stats.drawCalls++;
+    m_stats.vertices += batch.indexCount;
+    if (mode == GL_TRIANGLES) {
+        m_stats.triangles += batch.indexCount / 3;
+    }
+}
+
+void SceneRenderer::drawRanges(const DrawBatch& batch, GLenum mode, const std::vector<Range>& ranges,
+                               const std::vector<uint32_t>& visible) const {
+    if (visible.empty()) return;
+
+    // Ranges are laid out in upload order, so adjacent visible items coalesce
+    m_drawCounts.clear();
+    m_drawOffsets.clear();
+    size_t i = 0;
+    while (i < visible.size()) {
+        GLuint first = ranges[visible[i]].first;
+        GLsizei count = ranges[visible[i]].count;
+        size_t j = i + 1;
+        while (j < visible.size() && visible[j] == visible[j - 1] + 1) {
+            count += ranges[visible[j]].count;
+            j++;
+        }
+
+        if (count > 0) {
+            m_drawCounts.push_back(count);
+            m_drawOffsets.push_back(reinterpret_cast<const void*>(first * sizeof(GLuint)));
+            m_stats.vertices += count;
+            if (mode == GL_TRIANGLES) {
+                m_stats.triangles += count / 3;
+            }
+        }
+        i = j;
+    }
+    if (m_drawCounts.empty()) return;
+
+    glBindVertexArray(batch.vao);
+    glMultiDrawElements(mode, m_drawCounts.data(), GL_UNSIGNED_INT, m_drawOffsets.data(),
+                        static_cast<GLsizei>(m_drawCounts.size()));
+    glBindVertexArray(0);
+    m_stats.drawCalls++;
+}
+
+void SceneRenderer::setCellHighlighted(size_t cellIndex, bool highlight) {
+    if (cellIndex >= m_cellVertexRanges.size()) return;
+
+    const Range& range = m_cellVertexRanges[cellIndex];
+    std::vector<float> colors;
+    colors.reserve(range.count * 3);
+    for (GLsizei i = 0; i < range.count; i++) {
+        if (highlight) {
+            colors.insert(colors.end(), {1.0f, 0.0f, 0.0f}); // Red for highlighted cells
+        } else {
+            colors.insert(colors.end(), {0.0f, 0.0f, 1.0f}); // Blue for normal cells
+        }
+    }
+
+    // Keep the streaming copy in step so a buffer reallocation preserves the highlight
+    if (m_cellColorData.size() >= (range.first + range.count) * 3) {
+        std::copy(colors.begin(), colors.end(), m_cellColorData.begin() + range.first * 3);
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_cellColorVbo);
+    glBufferSubData(GL_ARRAY_BUFFER, range.first * 3 * sizeof(float),
+                    colors.size() * sizeof(float), colors.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneRenderer::clearGeometry() {
+    m_cellRanges.clear();
+    m_cellVertexRanges.clear();
+    m_surfaceTriangleRanges.clear();
+    m_surfaceEdgeRanges.clear();
+    m_cellBoxes.clear();
+    m_surfaceBoxes.clear();
+    m_cellVertexData.clear();
+    m_cellColorData.clear();
+    m_cellIndexData.clear();
+    m_surfaceVertexData.clear();
+    m_surfaceIndexData.clear();
+    m_surfaceEdgeIndexData.clear();
+    m_streamCapacity = StreamCapacity();
+}
+
+void SceneRenderer::uploadContours(const std::vector<ContourPlane>& contourPlanes) {
+    std::vector<float> vertices;
+    std::vector<GLuint> indices;
+    for (const auto& contourPlane : contourPlanes) {
+        GLuint base = static_cast<GLuint>(vertices.size() / 3);
+        for (const Point& p : contourPlane.vertices()) {
+            vertices.insert(vertices.end(), {(float)p.x(), (float)p.y(), (float)p.z()});
+        }
+        for (size_t e = 0; e < contourPlane.edgeCount(); e++) {
+            indices.push_back(base + contourPlane.edge(e)[0]);
+            indices.push_back(base + contourPlane.edge(e)[1]);
+        }
+    }
+    m_contourVbo = uploadVertices(vertices);
+    uploadBatch(m_contourLines, m_contourVbo, indices);
+}
+
+void SceneRenderer::appendCellGeometry(const SpacePartitioner::CellMesh& mesh) {
+    GLuint base = static_cast<GLuint>(m_cellVertexData.size() / 3);
+    Range range;
+    range.first = static_cast<GLuint>(m_cellIndexData.size());
+    Range vertexRange;
+    vertexRange.first = base;
+    vertexRange.count = static_cast<GLsizei>(mesh.vertices.size());
+    m_cellVertexRanges.push_back(vertexRange);
+    for (const auto& v : mesh.vertices) {
+        m_cellVertexData.insert(m_cellVertexData.end(), {(float)v[0], (float)v[1], (float)v[2]});
+        // Every cell starts out blue; setCellHighlighted rewrites a cell's colour range
+        m_cellColorData.insert(m_cellColorData.end(), {0.0f, 0.0f, 1.0f});
+    }
+    for (const auto& edge : mesh.edges) {
+        m_cellIndexData.push_back(base + edge.first);
+        m_cellIndexData.push_back(base + edge.second);
+    }
+    range.count = static_cast<GLsizei>(m_cellIndexData.size() - range.first);
+    m_cellRanges.push_back(range);
+    m_cellBoxes.push_back(mesh.bbox);
+}
+
+void SceneRenderer::appendSurfaceGeometry(const std::vector<Point>& vertices,
+                                          const std::vector<std::array<size_t, 3>>& triangles) {
+    GLuint base = static_cast<GLuint>(m_surfaceVertexData.size() / 3);
+    Range triangleRange;
+    Range edgeRange;
+    triangleRange.first = static_cast<GLuint>(m_surfaceIndexData.size());
+    edgeRange.first = static_cast<GLuint>(m_surfaceEdgeIndexData.size());
+
+    CGAL::Bbox_3 box;
+    for (const auto& p : vertices) {
+        m_surfaceVertexData.insert(m_surfaceVertexData.end(), {(float)p.x(), (float)p.y(), (float)p.z()});
+        box += p.bbox();
+    }
+
+    std::set<std::pair<size_t, size_t>> edges;
+    for (const auto& triangle : triangles) {
+        for (int i = 0; i < 3; i++) {
+            m_surfaceIndexData.push_back(base + static_cast<GLuint>(triangle[i]));
+            size_t a = triangle[i];
+            size_t b = triangle[(i + 1) % 3];
+            if (edges.insert({std::min(a, b), std::max(a, b)}).second) {
+                m_surfaceEdgeIndexData.push_back(base + static_cast<GLuint>(a));
+                m_surfaceEdgeIndexData.push_back(base + static_cast<GLuint>(b));
+            }
+        }
+    }
+
+    triangleRange.count = static_cast<GLsizei>(m_surfaceIndexData.size() - triangleRange.first);
+    edgeRange.count = static_cast<GLsizei>(m_surfaceEdgeIndexData.size() - edgeRange.first);
+    m_surfaceTriangleRanges.push_back(triangleRange);
+    m_surfaceEdgeRanges.push_back(edgeRange);
+    m_surfaceBoxes.push_back(box);
+}
+
+void SceneRenderer::upload(const std::vector<ContourPlane>& contourPlanes,
+                           const SpacePartitioner& partitioner,
+                           const Projection& projection) {
+    TRACE_SCOPE("SceneRenderer::upload");
+    release();
+    clearGeometry();
+    uploadContours(contourPlanes);
+
+    // Convex cell wireframes
+    for (const auto& cell : partitioner.getConvexCells()) {
+        appendCellGeometry(cell.mesh);
+    }
+    m_cellVbo = uploadVertices(m_cellVertexData);
+    m_cellColorVbo = uploadVertices(m_cellColorData);
+    uploadBatch(m_cellLines, m_cellVbo, m_cellIndexData, m_cellColorVbo);
+    m_cellBvh.build(m_cellBoxes);
+
+    // Reconstructed surfaces share one vertex buffer between fill and edges
+    for (const auto& cellProj : projection.getCellProjections()) {
+        for (const auto& proj : cellProj.projections) {
+            appendSurfaceGeometry(proj.reconstructedSurface->vertices, proj.reconstructedSurface->triangles);
+        }
+    }
+    m_surfaceVbo = uploadVertices(m_surfaceVertexData);
+    uploadBatch(m_surfaceTriangles, m_surfaceVbo, m_surfaceIndexData);
+    uploadBatch(m_surfaceEdges, m_surfaceVbo, m_surfaceEdgeIndexData);
+    m_surfaceBvh.build(m_surfaceBoxes);
+
+    // Nothing is appended after a full upload, so the staging copies can go
+    for (auto* data : {&m_cellVertexData, &m_cellColorData, &m_surfaceVertexData}) {
+        std::vector<float>().swap(*data);
+    }
+    for (auto* data : {&m_cellIndexData, &m_surfaceIndexData, &m_surfaceEdgeIndexData}) {
+        std::vector<GLuint>().swap(*data);
+    }
+}
+
+void SceneRenderer::appendToBuffer(GLenum target, GLuint buffer, size_t& capacity,
+                                   const void* data, size_t firstByte, size_t totalBytes) {
+    if (totalBytes == firstByte) return;
+    glBindBuffer(target, buffer);
+    if (totalBytes > capacity) {
+        capacity = std::max(totalBytes, 2 * capacity);
+        glBufferData(target, capacity, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(target, 0, totalBytes, data);
+    } else {
+        glBufferSubData(target, firstByte, totalBytes - firstByte,
+                        static_cast<const char*>(data) + firstByte);
+    }
+    glBindBuffer(target, 0);
+}
+
+void SceneRenderer::beginStream(const std::vector<ContourPlane>& contourPlanes) {
+    TRACE_SCOPE("SceneRenderer::beginStream");
+    release();
+    clearGeometry();
+    uploadContours(contourPlanes);
+
+    // Empty buffers that appendCells() grows; the VAOs keep pointing at them
+    m_cellVbo = uploadVertices({});
+    m_cellColorVbo = uploadVertices({});
+    m_surfaceVbo = uploadVertices({});
+    uploadBatch(m_cellLines, m_cellVbo, {}, m_cellColorVbo);
+    uploadBatch(m_surfaceTriangles, m_surfaceVbo, {});
+    uploadBatch(m_surfaceEdges, m_surfaceVbo, {});
+    m_cellBvh.build(m_cellBoxes);
+    m_surfaceBvh.build(m_surfaceBoxes);
+}
+
+void SceneRenderer::appendCells(const std::vector<StreamedCell>& cells) {
+    TRACE_SCOPE_ARG("SceneRenderer::appendCells", "cells", cells.size());
+    if (cells.empty()) return;
+
+    size_t cellVertexBytes = m_cellVertexData.size() * sizeof(float);
+    size_t cellIndexBytes = m_cellIndexData.size() * sizeof(GLuint);
+    size_t surfaceVertexBytes = m_surfaceVertexData.size() * sizeof(float);
+    size_t surfaceIndexBytes = m_surfaceIndexData.size() * sizeof(GLuint);
+    size_t surfaceEdgeBytes = m_surfaceEdgeIndexData.size() * sizeof(GLuint);
+
+    for (const auto& cell : cells) {
+        appendCellGeometry(cell.mesh);
+        for (const auto& surface : cell.surfaces) {
+            appendSurfaceGeometry(surface->vertices, surface->triangles);
+        }
+    }
+
+    // Only the new tail is sent unless a buffer has to grow
+    appendToBuffer(GL_ARRAY_BUFFER, m_cellVbo, m_streamCapacity.cellVertices, m_cellVertexData.data(),
+                   cellVertexBytes, m_cellVertexData.size() * sizeof(float));
+    appendToBuffer(GL_ARRAY_BUFFER, m_cellColorVbo, m_streamCapacity.cellColors, m_cellColorData.data(),
+                   cellVertexBytes, m_cellColorData.size() * sizeof(float));
+    appendToBuffer(GL_ELEMENT_ARRAY_BUFFER, m_cellLines.ibo, m_streamCapacity.cellIndices,
+                   m_cellIndexData.data(), cellIndexBytes, m_cellIndexData.size() * sizeof(GLuint));
+    appendToBuffer(GL_ARRAY_BUFFER, m_surfaceVbo, m_streamCapacity.surfaceVertices, m_surfaceVertexData.data(),
+                   surfaceVertexBytes, m_surfaceVertexData.size() * sizeof(float));
+    appendToBuffer(GL_ELEMENT_ARRAY_BUFFER, m_surfaceTriangles.ibo, m_streamCapacity.surfaceIndices,
+                   m_surfaceIndexData.data(), surfaceIndexBytes, m_surfaceIndexData.size() * sizeof(GLuint));
+    appendToBuffer(GL_ELEMENT_ARRAY_BUFFER, m_surfaceEdges.ibo, m_streamCapacity.surfaceEdges,
+                   m_surfaceEdgeIndexData.data(), surfaceEdgeBytes, m_surfaceEdgeIndexData.size() * sizeof(GLuint));
+    m_cellLines.indexCount = static_cast<GLsizei>(m_cellIndexData.size());
+    m_surfaceTriangles.indexCount = static_cast<GLsizei>(m_surfaceIndexData.size());
+    m_surfaceEdges.indexCount = static_cast<GLsizei>(m_surfaceEdgeIndexData.size());
+
+    m_cellBvh.build(m_cellBoxes);
+    m_surfaceBvh.build(m_surfaceBoxes);
+}
+
+void SceneRenderer::renderContours() const {
+    TRACE_SCOPE("renderContours");
+    glColor3f(1.0f, 0.0f, 0.0f);
+    drawBatch(m_contourLines, GL_LINES);
+}
+
+void SceneRenderer::renderConvexCells(const Frustum& frustum) const {
+    TRACE_SCOPE("renderConvexCells");
+    m_visible.clear();
+    m_cellBvh.query(frustum, m_visible);
+    std::sort(m_visible.begin(), m_visible.end());
+
+    // Colours come from the per-cell colour buffer, so all cells go out in one multi-draw
+    glLineWidth(2.0f);
+    drawRanges(m_cellLines, GL_LINES, m_cellRanges, m_visible);
+}
+
+void SceneRenderer::renderSurfaces(const Frustum& frustum) const {
+    TRACE_SCOPE("renderSurfaces");
+    m_visible.clear();
+    m_surfaceBvh.query(frustum, m_visible);
+    std::sort(m_visible.begin(), m_visible.end());
+
+    // Simple solid color rendering without lighting
+    glDisable(GL_LIGHTING);
+    glColor3f(1.0f, 0.6f, 0.8f);  // Pink color
+
+    // Push the fill back so the edges drawn on top do not z-fight
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.0f, 1.0f);
+    drawRanges(m_surfaceTriangles, GL_TRIANGLES, m_surfaceTriangleRanges, m_visible);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+
+    glLineWidth(1.0f);
+    glColor3f(0.0f, 0.0f, 0.0f);  // Black edges
+    drawRanges(m_surfaceEdges, GL_LINES, m_surfaceEdgeRanges, m_visible);
+}
+
+void renderAxisPlanes(const AxisPlanes& planes) {
+    glColor3f(1.0f, 0.75f, 0.8f);
+    glBegin(GL_QUADS);
+    for (const auto& plane : planes.planes) {
+        for (const auto& corner : plane.corners) {
+            glVertex3d(corner.x(), corner.y(), corner.z());
+        }
+    }
+    glEnd();
+}
+
+void renderPlanesForAllCells(const Projection& projection) {
+    for (size_t i = 0; i < projection.getCellCount(); i++) {
+        renderAxisPlanes(projection.getAxisPlanesForCell(i));
+    }
+}
@@ -0,0 +1,30 @@
+// run_control.cpp
+#include "run_control.h"
+#include "memory_stats.h"
+#include "timing.h"
+#include <string>
+#include <utility>
+
+RunControl::RunControl(const CancellationToken* token, const RunBudget& budget,
+                       ProgressCallback progress)
+    : m_token(token), m_budget(budget), m_progress(std::move(progress)),
+      m_start(std::chrono::steady_clock::now()) {}
+
+void RunControl::check() const {
+    if (m_token && m_token->isCancelled()) {
+        throw RunCancelled("Run cancelled");
+    }
+    if (m_budget.maxMs > 0.0 && elapsedMs(m_start) > m_budget.maxMs) {
+        throw RunCancelled("Time budget of " + std::to_string(m_budget.maxMs) + " ms exceeded");
+    }
+    if (m_budget.maxHeapBytes > 0 && getMemoryReport().totalLiveBytes > m_budget.maxHeapBytes) {
+        throw RunCancelled("Heap budget of " + std::to_string(toMegabytes(m_budget.maxHeapBytes)) +
+                           " MB exceeded");
+    }
+}
+
+void RunControl::report(const char* stage, size_t done, size_t total) {
+    if (!m_progress) return;
+    std::lock_guard<std::mutex> lock(m_progressMutex);
+    m_progress({stage, done, total});
+}
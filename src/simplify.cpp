@@ -0,0 +1,377 @@
+// simplify.cpp
+#include "simplify.h"
+#include "memory_stats.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+typedef std::pair<int, int> Materials;
+
+// Editable copy of one plane; the results go into a new ContourStore
+struct PlaneData {
+    Plane plane;
+    std::vector<Point> vertices;
+    std::vector<std::pair<int, int>> edges;
+    std::vector<Materials> edgeMaterials;
+};
+
+PlaneData copyPlane(const ContourPlane& view) {
+    PlaneData plane;
+    plane.plane = view.plane();
+    plane.vertices.assign(view.vertices().begin(), view.vertices().end());
+    for (size_t e = 0; e < view.edgeCount(); e++) {
+        // Out-of-range indices stay out of range and are rejected by extractChains
+        auto [v1, v2] = view.edge(e);
+        plane.edges.emplace_back(v1 > INT32_MAX ? -1 : int(v1), v2 > INT32_MAX ? -1 : int(v2));
+        plane.edgeMaterials.emplace_back(view.edgeMaterials(e)[0], view.edgeMaterials(e)[1]);
+    }
+    return plane;
+}
+
+// Consecutive edges sharing direction and materials; front() == back() for loops
+struct Chain {
+    std::vector<size_t> vertices;
+    Materials materials;
+    std::vector<bool> keep;
+};
+
+struct Segment {
+    size_t chain;
+    size_t first, last;  // Positions in the chain
+    double xmin, xmax, ymin, ymax;
+};
+
+Materials edgeMaterials(const PlaneData& plane, size_t edge) {
+    return edge < plane.edgeMaterials.size() ? plane.edgeMaterials[edge] : Materials(0, 0);
+}
+
+// Splits the edge graph at junctions, direction flips and material changes
+bool extractChains(const PlaneData& plane, std::vector<Chain>& chains) {
+    size_t vertexCount = plane.vertices.size();
+    std::vector<std::vector<size_t>> outgoing(vertexCount), incoming(vertexCount);
+    for (size_t e = 0; e < plane.edges.size(); e++) {
+        auto [v1, v2] = plane.edges[e];
+        if (v1 < 0 || v2 < 0 || static_cast<size_t>(v1) >= vertexCount ||
+            static_cast<size_t>(v2) >= vertexCount) {
+            return false;
+        }
+        outgoing[v1].push_back(e);
+        incoming[v2].push_back(e);
+    }
+
+    auto passThrough = [&](size_t v) {
+        return incoming[v].size() == 1 && outgoing[v].size() == 1 &&
+               edgeMaterials(plane, incoming[v][0]) == edgeMaterials(plane, outgoing[v][0]);
+    };
+
+    std::vector<bool> used(plane.edges.size(), false);
+    auto walk = [&](size_t edge) {
+        Chain chain;
+        chain.materials = edgeMaterials(plane, edge);
+        chain.vertices.push_back(plane.edges[edge].first);
+        while (!used[edge]) {
+            used[edge] = true;
+            size_t v = plane.edges[edge].second;
+            chain.vertices.push_back(v);
+            if (!passThrough(v)) break;
+            edge = outgoing[v][0];
+        }
+        chains.push_back(std::move(chain));
+    };
+
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (passThrough(v)) continue;
+        for (size_t e : outgoing[v]) {
+            if (!used[e]) walk(e);
+        }
+    }
+    // Whatever is left forms closed loops through pass-through vertices only
+    for (size_t e = 0; e < plane.edges.size(); e++) {
+        if (!used[e]) walk(e);
+    }
+    return true;
+}
+
+double squaredDistanceToSegment(const Point& p, const Point& a, const Point& b) {
+    if (a == b) return CGAL::squared_distance(p, a);
+    return CGAL::squared_distance(p, InexactKernel::Segment_3(a, b));
+}
+
+// Position in (first, last) farthest from the segment joining the two ends
+std::pair<size_t, double> farthestPosition(const PlaneData& plane, const Chain& chain,
+                                           size_t first, size_t last) {
+    const Point& a = plane.vertices[chain.vertices[first]];
+    const Point& b = plane.vertices[chain.vertices[last]];
+    std::pair<size_t, double> best(first, -1.0);
+    for (size_t i = first + 1; i < last; i++) {
+        double d = squaredDistanceToSegment(plane.vertices[chain.vertices[i]], a, b);
+        if (d > best.second) best = {i, d};
+    }
+    return best;
+}
+
+void douglasPeucker(const PlaneData& plane, Chain& chain, size_t first, size_t last,
+                    double squaredTolerance) {
+    std::vector<std::pair<size_t, size_t>> spans = {{first, last}};
+    while (!spans.empty()) {
+        auto [a, b] = spans.back();
+        spans.pop_back();
+        if (b - a < 2) continue;
+        auto [index, distance] = farthestPosition(plane, chain, a, b);
+        if (distance > squaredTolerance) {
+            chain.keep[index] = true;
+            spans.push_back({a, index});
+            spans.push_back({index, b});
+        }
+    }
+}
+
+void simplifyChain(const PlaneData& plane, Chain& chain, double squaredTolerance) {
+    size_t last = chain.vertices.size() - 1;
+    chain.keep.assign(chain.vertices.size(), false);
+    chain.keep[0] = chain.keep[last] = true;
+
+    bool closed = chain.vertices.front() == chain.vertices.back();
+    if (!closed || last < 3) {
+        douglasPeucker(plane, chain, 0, last, squaredTolerance);
+        return;
+    }
+
+    // Anchor loops at the start and the vertex farthest from it, and never
+    // let them collapse below a triangle
+    const Point& start = plane.vertices[chain.vertices[0]];
+    size_t anchor = 1;
+    for (size_t i = 2; i < last; i++) {
+        if (CGAL::squared_distance(plane.vertices[chain.vertices[i]], start) >
+            CGAL::squared_distance(plane.vertices[chain.vertices[anchor]], start)) {
+            anchor = i;
+        }
+    }
+    chain.keep[anchor] = true;
+    douglasPeucker(plane, chain, 0, anchor, squaredTolerance);
+    douglasPeucker(plane, chain, anchor, last, squaredTolerance);
+
+    if (std::count(chain.keep.begin(), chain.keep.end(), true) < 4) {
+        auto before = farthestPosition(plane, chain, 0, anchor);
+        auto after = farthestPosition(plane, chain, anchor, last);
+        chain.keep[before.second >= after.second ? before.first : after.first] = true;
+    }
+}
+
+double cross(double ax, double ay, double bx, double by) {
+    return ax * by - ay * bx;
+}
+
+// Drops the coordinate along the dominant normal axis
+std::pair<double, double> flatten(const Point& p, int droppedAxis) {
+    if (droppedAxis == 0) return {p.y(), p.z()};
+    if (droppedAxis == 1) return {p.z(), p.x()};
+    return {p.x(), p.y()};
+}
+
+bool segmentsIntersect(std::pair<double, double> p1, std::pair<double, double> p2,
+                       std::pair<double, double> q1, std::pair<double, double> q2) {
+    auto orient = [](std::pair<double, double> a, std::pair<double, double> b, std::pair<double, double> c) {
+        double o = cross(b.first - a.first, b.second - a.second, c.first - a.first, c.second - a.second);
+        return (o > 0) - (o < 0);
+    };
+    auto onSegment = [](std::pair<double, double> a, std::pair<double, double> b, std::pair<double, double> c) {
+        return std::min(a.first, b.first) <= c.first && c.first <= std::max(a.first, b.first) &&
+               std::min(a.second, b.second) <= c.second && c.second <= std::max(a.second, b.second);
+    };
+    int o1 = orient(p1, p2, q1), o2 = orient(p1, p2, q2);
+    int o3 = orient(q1, q2, p1), o4 = orient(q1, q2, p2);
+    if (o1 != o2 && o3 != o4) return true;
+    return (o1 == 0 && onSegment(p1, p2, q1)) || (o2 == 0 && onSegment(p1, p2, q2)) ||
+           (o3 == 0 && onSegment(q1, q2, p1)) || (o4 == 0 && onSegment(q1, q2, p2));
+}
+
+// Crossing-number test against the polygon closed by a shortcut over the
+// chain positions first..last
+bool insideSpan(const PlaneData& plane, const Chain& chain, size_t first, size_t last,
+                std::pair<double, double> p, int droppedAxis) {
+    bool inside = false;
+    for (size_t i = first; i <= last; i++) {
+        auto a = flatten(plane.vertices[chain.vertices[i]], droppedAxis);
+        auto b = flatten(plane.vertices[chain.vertices[i == last ? first : i + 1]], droppedAxis);
+        if ((a.second > p.second) != (b.second > p.second) &&
+            p.first < a.first + (b.first - a.first) * (p.second - a.second) / (b.second - a.second)) {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+// Splits shortcuts at their farthest dropped vertex when they cross another
+// edge of the plane or would move a remaining vertex to their other side;
+// returns false once every shortcut is safe
+bool splitUnsafeShortcuts(const PlaneData& plane, std::vector<Chain>& chains) {
+    auto normal = plane.plane.orthogonal_vector();
+    double nx = std::abs(normal.x()), ny = std::abs(normal.y()), nz = std::abs(normal.z());
+    int droppedAxis = (nx >= ny && nx >= nz) ? 0 : (ny >= nz ? 1 : 2);
+
+    std::vector<Segment> segments;
+    for (size_t c = 0; c < chains.size(); c++) {
+        const Chain& chain = chains[c];
+        size_t first = 0;
+        for (size_t i = 1; i < chain.vertices.size(); i++) {
+            if (!chain.keep[i]) continue;
+            auto a = flatten(plane.vertices[chain.vertices[first]], droppedAxis);
+            auto b = flatten(plane.vertices[chain.vertices[i]], droppedAxis);
+            segments.push_back({c, first, i,
+                                std::min(a.first, b.first), std::max(a.first, b.first),
+                                std::min(a.second, b.second), std::max(a.second, b.second)});
+            first = i;
+        }
+    }
+    std::sort(segments.begin(), segments.end(),
+              [](const Segment& a, const Segment& b) { return a.xmin < b.xmin; });
+
+    std::vector<size_t> crossing;
+    for (size_t i = 0; i < segments.size(); i++) {
+        const Segment& s = segments[i];
+        size_t s1 = chains[s.chain].vertices[s.first], s2 = chains[s.chain].vertices[s.last];
+        for (size_t j = i + 1; j < segments.size() && segments[j].xmin <= s.xmax; j++) {
+            const Segment& t = segments[j];
+            bool shortcut = s.last - s.first > 1, otherShortcut = t.last - t.first > 1;
+            if ((!shortcut && !otherShortcut) || t.ymin > s.ymax || t.ymax < s.ymin) continue;
+
+            size_t t1 = chains[t.chain].vertices[t.first], t2 = chains[t.chain].vertices[t.last];
+            if (s1 == t1 || s1 == t2 || s2 == t1 || s2 == t2) continue;  // Neighbours meet at a vertex
+            if (!segmentsIntersect(flatten(plane.vertices[s1], droppedAxis), flatten(plane.vertices[s2], droppedAxis),
+                                   flatten(plane.vertices[t1], droppedAxis), flatten(plane.vertices[t2], droppedAxis))) {
+                continue;
+            }
+            if (shortcut) crossing.push_back(i);
+            if (otherShortcut) crossing.push_back(j);
+        }
+    }
+
+    // Remaining vertices, by x, for the side test
+    std::vector<bool> dropped(plane.vertices.size(), false);
+    for (const Chain& chain : chains) {
+        for (size_t i = 0; i < chain.vertices.size(); i++) {
+            if (!chain.keep[i]) dropped[chain.vertices[i]] = true;
+        }
+    }
+    std::vector<std::pair<double, double>> remaining;
+    for (size_t v = 0; v < plane.vertices.size(); v++) {
+        if (!dropped[v]) remaining.push_back(flatten(plane.vertices[v], droppedAxis));
+    }
+    std::sort(remaining.begin(), remaining.end());
+
+    for (size_t i = 0; i < segments.size(); i++) {
+        const Segment& s = segments[i];
+        if (s.last - s.first < 2) continue;
+        const Chain& chain = chains[s.chain];
+
+        // The span polygon's bounding box covers the shortcut and the dropped vertices
+        double xmin = s.xmin, xmax = s.xmax, ymin = s.ymin, ymax = s.ymax;
+        for (size_t k = s.first + 1; k < s.last; k++) {
+            auto p = flatten(plane.vertices[chain.vertices[k]], droppedAxis);
+            xmin = std::min(xmin, p.first);
+            xmax = std::max(xmax, p.first);
+            ymin = std::min(ymin, p.second);
+            ymax = std::max(ymax, p.second);
+        }
+        auto a = flatten(plane.vertices[chain.vertices[s.first]], droppedAxis);
+        auto b = flatten(plane.vertices[chain.vertices[s.last]], droppedAxis);
+        for (auto p = std::lower_bound(remaining.begin(), remaining.end(), std::make_pair(xmin, ymin));
+             p != remaining.end() && p->first <= xmax; ++p) {
+            if (p->second < ymin || p->second > ymax || *p == a || *p == b) continue;
+            if (insideSpan(plane, chain, s.first, s.last, *p, droppedAxis)) {
+                crossing.push_back(i);
+                break;
+            }
+        }
+    }
+
+    for (size_t index : crossing) {
+        const Segment& s = segments[index];
+        Chain& chain = chains[s.chain];
+        chain.keep[farthestPosition(plane, chain, s.first, s.last).first] = true;
+    }
+    return !crossing.empty();
+}
+
+void simplifyPlane(PlaneData& plane, std::vector<Chain>& chains, double tolerance) {
+    for (Chain& chain : chains) {
+        simplifyChain(plane, chain, tolerance * tolerance);
+    }
+    while (splitUnsafeShortcuts(plane, chains)) {}
+
+    // Only chain interiors can be dropped; junctions and isolated vertices stay
+    std::vector<bool> removed(plane.vertices.size(), false);
+    for (const Chain& chain : chains) {
+        for (size_t i = 0; i < chain.vertices.size(); i++) {
+            if (!chain.keep[i]) removed[chain.vertices[i]] = true;
+        }
+    }
+
+    std::vector<int> remap(plane.vertices.size(), -1);
+    std::vector<Point> vertices;
+    for (size_t v = 0; v < plane.vertices.size(); v++) {
+        if (removed[v]) continue;
+        remap[v] = static_cast<int>(vertices.size());
+        vertices.push_back(plane.vertices[v]);
+    }
+
+    std::vector<std::pair<int, int>> edges;
+    std::vector<std::pair<int, int>> materials;
+    for (const Chain& chain : chains) {
+        size_t first = 0;
+        for (size_t i = 1; i < chain.vertices.size(); i++) {
+            if (!chain.keep[i]) continue;
+            edges.emplace_back(remap[chain.vertices[first]], remap[chain.vertices[i]]);
+            materials.push_back(chain.materials);
+            first = i;
+        }
+    }
+
+    plane.vertices = std::move(vertices);
+    plane.edges = std::move(edges);
+    plane.edgeMaterials = std::move(materials);
+}
+
+} // namespace
+
+SimplificationStats simplifyContours(std::vector<ContourPlane>& contourPlanes, double tolerance) {
+    TRACE_SCOPE("simplifyContours");
+    MemoryStageScope memoryStage(MemoryStage::Parse);
+    SimplificationStats stats;
+    if (contourPlanes.empty()) return stats;
+
+    ContourStoreBuilder builder(contourPlanes[0].filename());
+    for (const ContourPlane& view : contourPlanes) {
+        PlaneData plane = copyPlane(view);
+        stats.inputVertices += plane.vertices.size();
+
+        // Extended meshes index the contour vertices through their own edge list
+        std::vector<Chain> chains;
+        if (view.hasExt() || !extractChains(plane, chains)) {
+            stats.skippedPlanes++;
+        } else if (tolerance > 0.0) {
+            simplifyPlane(plane, chains, tolerance);
+        }
+
+        stats.outputVertices += plane.vertices.size();
+
+        builder.beginPlane(plane.plane);
+        for (const Point& p : plane.vertices) {
+            builder.addVertex(p);
+        }
+        for (size_t e = 0; e < plane.edges.size(); e++) {
+            builder.addEdge(static_cast<uint32_t>(plane.edges[e].first), static_cast<uint32_t>(plane.edges[e].second),
+                            plane.edgeMaterials[e].first, plane.edgeMaterials[e].second);
+        }
+        if (view.hasExt()) {
+            builder.setExtendedMesh(view.extMesh());
+        }
+    }
+    contourPlanes = builder.build();
+    return stats;
+}
@@ -0,0 +1,88 @@
+// thread_pool.cpp
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // The calling thread takes slot 0 and works alongside the pool
+    for (size_t slot = 1; slot < threadCount; slot++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, slot);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& task) {
+    if (count == 0) return;
+    std::lock_guard<std::mutex> callLock(m_callMutex);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task = &task;
+    m_count = count;
+    m_next = 0;
+    m_error = nullptr;
+    m_generation++;
+    m_wake.notify_all();
+
+    runTasks(lock, 0);
+    m_done.wait(lock, [this]() { return m_next >= m_count && m_active == 0; });
+
+    m_task = nullptr;
+    std::exception_ptr error = m_error;
+    m_error = nullptr;
+    lock.unlock();
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(size_t slot) {
+    setTraceThreadName("pool worker");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    size_t seenGeneration = m_generation;
+    while (true) {
+        m_wake.wait(lock, [&]() { return m_stopping || m_generation != seenGeneration; });
+        if (m_stopping) return;
+        seenGeneration = m_generation;
+        runTasks(lock, slot);
+    }
+}
+
+void ThreadPool::runTasks(std::unique_lock<std::mutex>& lock, size_t slot) {
+    while (m_next < m_count) {
+        size_t index = m_next++;
+        m_active++;
+        lock.unlock();
+
+        std::exception_ptr error;
+        try {
+            (*m_task)(index, slot);
+        }
+        catch (...) {
+            error = std::current_exception();
+        }
+
+        lock.lock();
+        if (error && !m_error) {
+            m_error = error;
+            m_next = m_count;  // Skip the remaining tasks
+        }
+        m_active--;
+    }
+    if (m_active == 0) {
+        m_done.notify_all();
+    }
+}
@@ -0,0 +1,195 @@
+// trace.cpp
+#include "trace.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> g_traceEnabled{false};
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    const char* argName;
+    int64_t argValue;
+    int64_t startNs;
+    int64_t endNs;
+};
+
+// Events are appended to fixed-size chunks by the owning thread only. The writer
+// walks the chunk list and reads up to each published count, so recording never
+// takes a lock and never moves an event after it is written.
+struct TraceChunk {
+    static constexpr size_t CAPACITY = 4096;
+    TraceEvent events[CAPACITY];
+    std::atomic<size_t> count{0};
+    std::atomic<TraceChunk*> next{nullptr};
+};
+
+struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::atomic<const char*> threadName{nullptr};
+    TraceChunk* head = nullptr;
+    TraceChunk* tail = nullptr;
+
+    ~ThreadBuffer() {
+        while (head) {
+            TraceChunk* next = head->next.load(std::memory_order_relaxed);
+            delete head;
+            head = next;
+        }
+    }
+};
+
+// Buffers outlive their threads so events from finished workers are still written
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+};
+
+TraceRegistry& registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+// Registration takes the lock once per thread; recording afterwards does not
+ThreadBuffer& threadBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        TraceRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = reg.buffers.back().get();
+        buffer->threadId = static_cast<uint32_t>(reg.buffers.size());
+        buffer->head = buffer->tail = new TraceChunk();
+    }
+    return *buffer;
+}
+
+void writeJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        out << *c;
+    }
+    out << '"';
+}
+
+bool writeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    for (const auto& buffer : reg.buffers) {
+        const char* threadName = buffer->threadName.load(std::memory_order_acquire);
+        if (threadName) {
+            separator();
+            out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"args\":{\"name\":";
+            writeJsonString(out, threadName);
+            out << "}}";
+        }
+
+        for (TraceChunk* chunk = buffer->head; chunk;
+             chunk = chunk->next.load(std::memory_order_acquire)) {
+            size_t count = chunk->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++) {
+                const TraceEvent& e = chunk->events[i];
+                separator();
+                out << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"name\":";
+                writeJsonString(out, e.name);
+                out << ",\"ts\":" << e.startNs / 1000.0
+                    << ",\"dur\":" << (e.endNs - e.startNs) / 1000.0;
+                if (e.argName) {
+                    out << ",\"args\":{";
+                    writeJsonString(out, e.argName);
+                    out << ":" << e.argValue << "}";
+                }
+                out << "}";
+            }
+        }
+    }
+
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace
+
+int64_t traceNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry().origin).count();
+}
+
+void recordTraceEvent(const char* name, int64_t startNs, int64_t endNs,
+                      const char* argName, int64_t argValue) {
+    ThreadBuffer& buffer = threadBuffer();
+    TraceChunk* chunk = buffer.tail;
+    size_t count = chunk->count.load(std::memory_order_relaxed);
+    if (count == TraceChunk::CAPACITY) {
+        TraceChunk* fresh = new TraceChunk();
+        chunk->next.store(fresh, std::memory_order_release);
+        buffer.tail = chunk = fresh;
+        count = 0;
+    }
+    chunk->events[count] = {name, argName, argValue, startNs, endNs};
+    chunk->count.store(count + 1, std::memory_order_release);
+}
+
+void setTraceThreadName(const char* name) {
+    if (!traceEnabled()) return;
+    threadBuffer().threadName.store(name, std::memory_order_release);
+}
+
+TraceSession::TraceSession(const std::string& path) : m_path(path) {
+    if (m_path.empty()) return;
+    registry();  // Fix the time origin before the first event
+    g_traceEnabled.store(true, std::memory_order_relaxed);
+    setTraceThreadName("main");
+}
+
+TraceSession::~TraceSession() {
+    if (m_path.empty()) return;
+    g_traceEnabled.store(false, std::memory_order_relaxed);
+    if (writeTrace(m_path)) {
+        std::cout << "Trace written to " << m_path << std::endl;
+    } else {
+        std::cerr << "Could not write trace: " << m_path << std::endl;
+    }
+}
+
+std::string parseTraceArguments(int& argc, char** argv) {
+    std::string path;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            path = argv[i + 1];
+            for (int j = i; j + 2 <= argc; j++) {
+                argv[j] = argv[j + 2];
+            }
+            argc -= 2;
+            break;
+        }
+    }
+
+    if (path.empty()) {
+        if (const char* env = std::getenv("SURFACE_TRACE")) {
+            path = env;
+        }
+    }
+    return path;
+}